@@ -24,9 +24,17 @@
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
 #include "EventAction.hh"
+#include "StackingAction.hh"
+#include "SteppingAction.hh"
+#include "PlaneScorer.hh"
+#include "RangeRejection.hh"
+#include "EmPresets.hh"
+#include "EmOnlyPhysicsList.hh"
 
 #include "G4PhysListFactory.hh"
 #include "G4ParallelWorldPhysics.hh"
+#include "G4StepLimiterPhysics.hh"
+#include "G4FastSimulationPhysics.hh"
 
 #include "G4Version.hh"
 #if G4VERSION_NUMBER >= 1060
@@ -37,6 +45,8 @@
 #endif
 
 #include "RootFileWriter.hh"
+#include "EventReplay.hh"
+#include "ScatterKernel.hh"
 
 #include "G4SystemOfUnits.hh"
 #include "G4String.hh"
@@ -55,6 +65,9 @@
 
 //#include <unistd.h> //getopt()
 #include <getopt.h> // Long options to getopt (GNU extension)
+#include <csignal>
+#include <fcntl.h>
+#include <limits>
 
 void printHelp(G4double target_thick,
                G4String target_material,
@@ -64,6 +77,13 @@ void printHelp(G4double target_thick,
                G4double world_size,
                G4String physListName,
                G4double physCutoffDist,
+               G4double targetCut,
+               G4double objectCut,
+               G4double rangeRejection,
+               G4String emPreset,
+               G4String emPresetTarget,
+               G4String emPresetObject,
+               G4bool   targetFastSim,
                G4double beam_energy,
                G4double beam_eFlat_min,
                G4double beam_eFlat_max,
@@ -78,6 +98,31 @@ void printHelp(G4double target_thick,
                G4bool   quickmode,
                G4bool   anaScatterTest,
                G4bool   miniROOTfile,
+               G4bool   perEventTrees,
+               G4String treeFilter,
+               G4int    treeReservoir,
+               G4String eventTrigger,
+               G4int    chunkEvents,
+               G4double chunkSizeMB,
+               G4bool   statsOnly,
+               G4String precision,
+               G4int    precisionBatch,
+               G4int    checkpointEvents,
+               G4double checkpointTime,
+               G4bool   resume,
+               G4double liveSnapshotTime,
+               G4double maxWallTime,
+               G4int    progressFD,
+               G4double progressInterval,
+               G4String recordRNG,
+               G4String replay,
+               Long64_t eventIDOffset,
+               G4int    autoRange,
+               G4String stacking,
+               G4String writeKernel,
+               G4String readKernel,
+               G4bool   analyticDrift,
+               G4String scorePlanes,
                G4double cutoff_energyFraction,
                G4double cutoff_radius,
                G4double edep_dens_dz,
@@ -120,6 +165,13 @@ int main(int argc,char** argv) {
 
     G4String physListName = "QGSP_FTFP_BERT"; // Name of physics list to use
     G4double physCutoffDist = 0.1;            // Default physics cutoff distance [mm]
+    G4double targetCut      = -1.0;           // Physics cutoff distance in the target [mm] (< 0 => default)
+    G4double objectCut      = -1.0;           // Physics cutoff distance in the objects [mm] (< 0 => default)
+    G4double rangeRejection = 0.0;            // Max kinetic energy for e-/e+ range rejection [MeV] (0 => off)
+    G4String emPreset       = "";             // EM preset, see EmPresets.hh ("" => physics list defaults)
+    G4String emPresetTarget = "";             // EM preset in the target region ("" => as elsewhere)
+    G4String emPresetObject = "";             // EM preset in the object regions ("" => as elsewhere)
+    G4bool   targetFastSim  = false;          // Fast simulation of the passage through a thin target
 
     G4int    numEvents    = 0;                // Number of events to generate
 
@@ -131,6 +183,31 @@ int main(int argc,char** argv) {
     G4String foldername_out = "plots";        // Output foldername
     G4bool   miniROOTfile   = false;          // Write small root file
                                               // (only analysis output, no TTrees)
+    G4bool   perEventTrees  = false;          // Store TTrees with one entry per event
+    G4String treeFilter     = "";             // Selection of hits to store in the TTrees
+    G4int    treeReservoir  = 0;              // Max hits stored per plane (0 => no limit)
+    G4String eventTrigger   = "";             // Only store TTree entries for events passing this
+    G4int    chunkEvents    = 0;              // Max events per TTree chunk file (0 => no limit)
+    G4double chunkSizeMB    = 0.0;            // Approximate max size of each TTree chunk file [MB] (0 => no limit)
+    G4bool   statsOnly      = false;          // Only write the scalar statistics (no histograms or TTrees)
+    G4String precision      = "";             // Stop when these relative uncertainties are reached
+    G4int    precisionBatch = 1000;           // Events per batch for estimating the uncertainties
+    G4int    checkpointEvents = 0;            // Write a checkpoint every N events (0 => never)
+    G4double checkpointTime   = 0.0;          // Write a checkpoint every T seconds (0 => never)
+    G4bool   resume           = false;        // Continue from the last checkpoint
+    G4double liveSnapshotTime = 0.0;          // Write a live snapshot every T seconds (0 => never)
+    G4double maxWallTime      = 0.0;          // Stop the run after this many seconds (0 => no limit)
+    G4int    progressFD       = -1;           // Write JSON progress reports to this file descriptor (-1 => disabled)
+    G4double progressInterval = 1.0;          // Minimum time between progress reports [s]
+    G4String recordRNG        = "";           // Record the RNG state per event: "all", "trigger" or "" (disabled)
+    G4String replay           = "";           // Re-simulate events recorded with --recordRNG
+    Long64_t eventIDOffset    = 0;            // Added to the eventIDs, e.g. for sharded runs
+    G4int    autoRange        = 0;            // Hits per phase space used for choosing the histogram ranges (0 => fixed)
+    G4String stacking         = "";           // Rules for killing or postponing secondaries
+    G4String writeKernel      = "";           // Write the target scattering kernel to this file
+    G4String readKernel       = "";           // Sample the target from this scattering kernel file
+    G4bool   analyticDrift    = false;        // Move tracks analytically from the last material to the trackers
+    G4String scorePlanes      = "";           // Scoring planes without geometry volumes
 
     G4int    rngSeed        = 0;              // RNG seed
 
@@ -153,6 +230,13 @@ int main(int argc,char** argv) {
                                            {"ang",                   required_argument, NULL, 'a'  },
                                            {"phys",                  required_argument, NULL, 'p'  },
                                            {"physCutoffDist",        required_argument, NULL, 1400 },
+                                           {"targetCut",             required_argument, NULL, 1401 },
+                                           {"objectCut",             required_argument, NULL, 1402 },
+                                           {"rangeRejection",        required_argument, NULL, 1403 },
+                                           {"emPreset",              required_argument, NULL, 1404 },
+                                           {"emPresetTarget",        required_argument, NULL, 1405 },
+                                           {"emPresetObject",        required_argument, NULL, 1406 },
+                                           {"targetFastSim",         no_argument,       NULL, 1407 },
                                            // -n is only short
                                            {"energy",                required_argument, NULL, 'e'  },
                                            {"energyDistFlat",        required_argument, NULL, 1300 },
@@ -169,6 +253,31 @@ int main(int argc,char** argv) {
                                            {"quickmode",             no_argument,       NULL, 'q'  },
                                            {"anaScatterTest",        no_argument,       NULL, 1004 },
                                            {"miniroot",              no_argument,       NULL, 'r'  },
+                                           {"perEventTrees",         no_argument,       NULL, 1005 },
+                                           {"treeFilter",            required_argument, NULL, 1006 },
+                                           {"treeReservoir",         required_argument, NULL, 1007 },
+                                           {"trigger",               required_argument, NULL, 1008 },
+                                           {"chunkEvents",           required_argument, NULL, 1009 },
+                                           {"chunkSize",             required_argument, NULL, 1010 },
+                                           {"statsOnly",             no_argument,       NULL, 1011 },
+                                           {"precision",             required_argument, NULL, 1012 },
+                                           {"precisionBatch",        required_argument, NULL, 1013 },
+                                           {"checkpointEvents",      required_argument, NULL, 1014 },
+                                           {"checkpointTime",        required_argument, NULL, 1015 },
+                                           {"resume",                no_argument,       NULL, 1016 },
+                                           {"liveSnapshot",          required_argument, NULL, 1017 },
+                                           {"maxWallTime",           required_argument, NULL, 1018 },
+                                           {"progressFD",            required_argument, NULL, 1019 },
+                                           {"progressInterval",      required_argument, NULL, 1020 },
+                                           {"recordRNG",             required_argument, NULL, 1021 },
+                                           {"replay",                required_argument, NULL, 1022 },
+                                           {"eventIDOffset",         required_argument, NULL, 1023 },
+                                           {"autoRange",             required_argument, NULL, 1024 },
+                                           {"stacking",              required_argument, NULL, 1025 },
+                                           {"writeKernel",           required_argument, NULL, 1026 },
+                                           {"readKernel",            required_argument, NULL, 1027 },
+                                           {"analyticDrift",         no_argument,       NULL, 1028 },
+                                           {"scorePlanes",           required_argument, NULL, 1029 },
                                            {"cutoffEnergyFraction",  required_argument, NULL, 1000 },
                                            {"cutoffRadius",          required_argument, NULL, 1001 },
                                            {"edepDZ",                required_argument, NULL, 1002 },
@@ -189,6 +298,13 @@ int main(int argc,char** argv) {
                       world_size,
                       physListName,
                       physCutoffDist,
+                      targetCut,
+                      objectCut,
+                      rangeRejection,
+                      emPreset,
+                      emPresetTarget,
+                      emPresetObject,
+                      targetFastSim,
                       beam_energy,
                       beam_eFlat_min,
                       beam_eFlat_max,
@@ -203,6 +319,31 @@ int main(int argc,char** argv) {
                       quickmode,
                       anaScatterTest,
                       miniROOTfile,
+                      perEventTrees,
+                      treeFilter,
+                      treeReservoir,
+                      eventTrigger,
+                      chunkEvents,
+                      chunkSizeMB,
+                      statsOnly,
+                      precision,
+                      precisionBatch,
+                      checkpointEvents,
+                      checkpointTime,
+                      resume,
+                      liveSnapshotTime,
+                      maxWallTime,
+                      progressFD,
+                      progressInterval,
+                      recordRNG,
+                      replay,
+                      eventIDOffset,
+                      autoRange,
+                      stacking,
+                      writeKernel,
+                      readKernel,
+                      analyticDrift,
+                      scorePlanes,
                       cutoff_energyFraction,
                       cutoff_radius,
                       edep_dens_dz,
@@ -311,6 +452,61 @@ int main(int argc,char** argv) {
             }
             break;
 
+        case 1401: //Physics cutoff distance in the target region
+            try {
+                targetCut = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading targetCut" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1402: //Physics cutoff distance in the magnet/object regions
+            try {
+                objectCut = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading objectCut" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1403: //Electron range rejection (--rangeRejection)
+            try {
+                rangeRejection = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading rangeRejection" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1404: //EM accuracy/speed preset
+            emPreset = G4String(optarg);
+            EmPresets::CheckPresetName(emPreset, "--emPreset");
+            break;
+
+        case 1405: //EM preset in the target region
+            emPresetTarget = G4String(optarg);
+            EmPresets::CheckPresetName(emPresetTarget, "--emPresetTarget");
+            break;
+
+        case 1406: //EM preset in the magnet/object regions
+            emPresetObject = G4String(optarg);
+            EmPresets::CheckPresetName(emPresetObject, "--emPresetObject");
+            break;
+
+        case 1407: //Fast simulation model for thin targets
+            targetFastSim = true;
+            break;
+
         case 'm': //Target material
             target_material = G4String(optarg);
             break;
@@ -325,6 +521,14 @@ int main(int argc,char** argv) {
                        << "Expected an integer!" << G4endl;
                 exit(1);
             }
+            catch (const std::out_of_range& oor) {
+                // Geant4 counts the events in a run with an int
+                G4cout << "Number of events out of range" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected at most " << std::numeric_limits<G4int>::max() << " events per run;"
+                       << " split the run into several runs with different seeds (-s) and --eventIDOffset" << G4endl;
+                exit(1);
+            }
             break;
 
         case 'e': //beam energy
@@ -451,6 +655,261 @@ int main(int argc,char** argv) {
             miniROOTfile = true;
             break;
 
+        case 1005: //One TTree entry per event
+            perEventTrees = true;
+            break;
+
+        case 1006: //Selection of hits to store in the TTrees
+            treeFilter = G4String(optarg);
+            break;
+
+        case 1007: //Reservoir sampling of hits to store in the TTrees
+            try {
+                treeReservoir = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading treeReservoir" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (treeReservoir < 0) {
+                G4cout << "treeReservoir must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1008: //Event trigger for the TTrees
+            eventTrigger = G4String(optarg);
+            break;
+
+        case 1009: //Max number of events per TTree chunk file
+            try {
+                chunkEvents = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading chunkEvents" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (chunkEvents < 0) {
+                G4cout << "chunkEvents must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1010: //Approximate max size of each TTree chunk file
+            try {
+                chunkSizeMB = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading chunkSize" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (chunkSizeMB < 0.0) {
+                G4cout << "chunkSize must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1011: //Only write the scalar statistics
+            statsOnly = true;
+            break;
+
+        case 1012: //Precision targets for stopping the run
+            precision = G4String(optarg);
+            break;
+
+        case 1013: //Events per batch for the precision estimate
+            try {
+                precisionBatch = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading precisionBatch" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (precisionBatch < 1) {
+                G4cout << "precisionBatch must be >= 1" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1014: //Checkpoint interval in events
+            try {
+                checkpointEvents = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading checkpointEvents" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (checkpointEvents < 0) {
+                G4cout << "checkpointEvents must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1015: //Checkpoint interval in seconds
+            try {
+                checkpointTime = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading checkpointTime" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (checkpointTime < 0.0) {
+                G4cout << "checkpointTime must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1016: //Continue from the last checkpoint
+            resume = true;
+            break;
+
+        case 1017: //Live snapshot interval in seconds
+            try {
+                liveSnapshotTime = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading liveSnapshot" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (liveSnapshotTime < 0.0) {
+                G4cout << "liveSnapshot must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1018: //Maximum wall time in seconds
+            try {
+                maxWallTime = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading maxWallTime" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (maxWallTime < 0.0) {
+                G4cout << "maxWallTime must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1019: //File descriptor for progress reports
+            try {
+                progressFD = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading progressFD" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (progressFD >= 0 and fcntl(progressFD, F_GETFD) == -1) {
+                G4cout << "progressFD = " << progressFD << " is not an open file descriptor" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1020: //Time between progress reports
+            try {
+                progressInterval = std::stod(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading progressInterval" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+                exit(1);
+            }
+            if (progressInterval < 0.0) {
+                G4cout << "progressInterval must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1021: //Record the RNG state for replaying events
+            recordRNG = G4String(optarg);
+            if (recordRNG != "all" and recordRNG != "trigger") {
+                G4cout << "Invalid argument when reading recordRNG" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected 'all' or 'trigger'!" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1022: //Replay recorded events
+            replay = G4String(optarg);
+            break;
+
+        case 1023: //Offset of the eventIDs
+            try {
+                eventIDOffset = std::stoll(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading eventIDOffset" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            catch (const std::out_of_range& oor) {
+                G4cout << "eventIDOffset out of range" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl;
+                exit(1);
+            }
+            if (eventIDOffset < 0) {
+                G4cout << "eventIDOffset must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1024: //Automatic phase space histogram ranges
+            try {
+                autoRange = std::stoi(string(optarg));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cout << "Invalid argument when reading autoRange" << G4endl
+                       << "Got: '" << optarg << "'" << G4endl
+                       << "Expected an integer!" << G4endl;
+                exit(1);
+            }
+            if (autoRange < 0) {
+                G4cout << "autoRange must be >= 0" << G4endl;
+                exit(1);
+            }
+            break;
+
+        case 1025: //Stacking policy for secondaries
+            stacking = G4String(optarg);
+            break;
+
+        case 1026: //Write a scattering kernel
+            writeKernel = G4String(optarg);
+            break;
+
+        case 1027: //Read a scattering kernel
+            readKernel = G4String(optarg);
+            break;
+
+        case 1028: //Analytic drift to the trackers
+            analyticDrift = true;
+            break;
+
+        case 1029: //Scoring planes without geometry volumes
+            scorePlanes = G4String(optarg);
+            break;
+
         case 's': //RNG seed
             try {
                 rngSeed = std::stoi(string(optarg));
@@ -538,6 +997,48 @@ int main(int argc,char** argv) {
         }
     }
 
+    // Replay recorded events; this sets the number of events
+    EventReplay* eventReplay = NULL;
+    if (replay != "") {
+        eventReplay = new EventReplay();
+        eventReplay->Load(replay);
+        numEvents = eventReplay->GetNumEvents();
+    }
+
+    // Scattering kernels of the target
+    const G4bool beam_eFlat = (beam_eFlat_min >= 0.0 and beam_eFlat_max > 0.0);
+    if (writeKernel != "" or readKernel != "") {
+        if (target_thick <= 0.0) {
+            G4cerr << "Error: --writeKernel and --readKernel require a target" << G4endl;
+            exit(1);
+        }
+        if (writeKernel != "" and readKernel != "") {
+            G4cerr << "Error: --writeKernel and --readKernel can not be used together" << G4endl;
+            exit(1);
+        }
+        if (readKernel != "" and replay != "") {
+            // The replayed events were tracked through the target, not sampled from a kernel
+            G4cerr << "Error: --readKernel can not be used with --replay" << G4endl;
+            exit(1);
+        }
+    }
+    ScatterKernel* kernelIn = NULL;
+    if (readKernel != "") {
+        kernelIn = new ScatterKernel();
+        kernelIn->Load(readKernel);
+        kernelIn->CheckCompatible(target_material, target_thick, target_angle, beam_energy, beam_type, beam_eFlat);
+    }
+    ScatterKernel* kernelOut = NULL;
+    if (writeKernel != "") {
+        if (target_angle != 0.0 or beam_eFlat) {
+            G4cerr << "Error: --writeKernel requires a target without rotation and a beam without flat energy distribution" << G4endl;
+            exit(1);
+        }
+        kernelOut = new ScatterKernel();
+        kernelOut->OpenForWriting(writeKernel, target_material, target_thick, beam_energy, beam_type);
+        RootFileWriter::GetInstance()->setKernelWriter(kernelOut);
+    }
+
     //Copy remaining arguments to array that is passed to Geant4
     int argc_effective = argc-optind+1;
     char** argv_effective = new char*[argc_effective];
@@ -555,6 +1056,13 @@ int main(int argc,char** argv) {
               world_size,
               physListName,
               physCutoffDist,
+              targetCut,
+              objectCut,
+              rangeRejection,
+              emPreset,
+              emPresetTarget,
+              emPresetObject,
+              targetFastSim,
               beam_energy,
               beam_eFlat_min,
               beam_eFlat_max,
@@ -569,6 +1077,31 @@ int main(int argc,char** argv) {
               quickmode,
               anaScatterTest,
               miniROOTfile,
+              perEventTrees,
+              treeFilter,
+              treeReservoir,
+              eventTrigger,
+              chunkEvents,
+              chunkSizeMB,
+              statsOnly,
+              precision,
+              precisionBatch,
+              checkpointEvents,
+              checkpointTime,
+              resume,
+              liveSnapshotTime,
+              maxWallTime,
+              progressFD,
+              progressInterval,
+              recordRNG,
+              replay,
+              eventIDOffset,
+              autoRange,
+              stacking,
+              writeKernel,
+              readKernel,
+              analyticDrift,
+              scorePlanes,
               cutoff_energyFraction,
               cutoff_radius,
               edep_dens_dz,
@@ -587,6 +1120,19 @@ int main(int argc,char** argv) {
     }
     G4cout << G4endl;
 
+    // Start counting the wall time before initializing Geant4
+    RootFileWriter::GetInstance()->setMaxWallTime(maxWallTime);
+    if (not useGUI) {
+        // Stop after the current event, so that the output file is still written
+        signal(SIGTERM, RootFileWriter::HandleStopSignal);
+        signal(SIGINT,  RootFileWriter::HandleStopSignal);
+        signal(SIGUSR1, RootFileWriter::HandleStopSignal);
+    }
+    if (progressFD >= 0) {
+        // Report write errors instead of being killed if the reader goes away
+        signal(SIGPIPE, SIG_IGN);
+    }
+
     G4cout << "Starting Geant4..." << G4endl << G4endl;
 
     G4RunManager* runManager = new G4RunManager;
@@ -604,7 +1150,13 @@ int main(int argc,char** argv) {
     // Physics
     G4int verbose=0;
     G4PhysListFactory plFactory;
-    G4VModularPhysicsList* physlist = plFactory.GetReferencePhysList(physListName);
+    G4VModularPhysicsList* physlist = NULL;
+    if (EmOnlyPhysicsList::IsEmOnlyName(physListName)) {
+        physlist = new EmOnlyPhysicsList(physListName);
+    }
+    else {
+        physlist = plFactory.GetReferencePhysList(physListName);
+    }
     if (physlist==NULL) {
         G4cerr << "Bad physics list!" << G4endl;
         G4cerr << G4endl;
@@ -623,6 +1175,10 @@ int main(int argc,char** argv) {
         }
         G4cerr << G4endl;
 
+        G4cerr << "Lightweight EM-only physics lists:" << G4endl;
+        EmOnlyPhysicsList::PrintNames();
+        G4cerr << G4endl;
+
         exit(1);
     }
     physlist->SetVerboseLevel(verbose);
@@ -645,12 +1201,68 @@ int main(int argc,char** argv) {
         world_min_length = world_min_length_beam;
     }
 
+    // Scoring planes without geometry volumes; the world must reach them
+    PlaneScorer* planeScorer = NULL;
+    if (scorePlanes != "") {
+        planeScorer = new PlaneScorer(scorePlanes, detector_angle);
+        std::vector<G4double> planeDistances = planeScorer->GetDistances_mm();
+        G4double world_min_length_planes =
+            VirtualTrackerWorldConstruction::ComputeMaxAbsZ(&planeDistances, detector_angle, world_size) * 2.0;
+        if (world_min_length_planes > world_min_length) {
+            world_min_length = world_min_length_planes;
+        }
+        RootFileWriter::GetInstance()->setPlaneScorer(planeScorer);
+    }
+
     DetectorConstruction* physWorld = new DetectorConstruction(target_thick,
                                                                target_material,
                                                                target_angle,
                                                                world_size,
                                                                world_min_length,
                                                                magnetDefinitions);
+    physWorld->SetTargetCut(targetCut);
+    physWorld->SetObjectCut(objectCut);
+    physWorld->SetTargetFastSim(targetFastSim);
+
+    // The objects' tracking limits (minEkin, maxTrackLength, maxTime) are applied by G4UserSpecialCuts;
+    // for all particles, since the showers are mostly photons
+    if (physWorld->GetHasUserLimits()) {
+        G4StepLimiterPhysics* stepLimiterPhysics = new G4StepLimiterPhysics();
+        stepLimiterPhysics->SetApplyToAll(true);
+        physlist->RegisterPhysics(stepLimiterPhysics);
+    }
+
+    // The model itself is attached to the target region by DetectorConstruction
+    if (targetFastSim) {
+        if (target_thick <= 0.0) {
+            G4cerr << "Error: --targetFastSim requires a target (-t > 0)" << G4endl;
+            exit(1);
+        }
+        G4FastSimulationPhysics* fastSimPhysics = new G4FastSimulationPhysics();
+        for (auto particleName : {"e-", "e+", "mu-", "mu+", "pi-", "pi+", "proton", "anti_proton"}) {
+            fastSimPhysics->ActivateFastSimulation(particleName);
+        }
+        physlist->RegisterPhysics(fastSimPhysics);
+    }
+
+    // Electrons that can not leave a field-free volume are stopped and deposit their energy locally
+    if (rangeRejection > 0.0) {
+        physlist->RegisterPhysics(new RangeRejectionPhysics(rangeRejection));
+    }
+
+    // EM accuracy/speed presets, globally and in the target and object regions
+    if (emPreset != "") {
+        EmPresets::ApplyGlobal(emPreset);
+    }
+    if (emPresetTarget != "" && physWorld->GetHasTarget()) {
+        EmPresets::ApplyRegion(emPresetTarget, "Target");
+    }
+    for (auto mag : physWorld->magnets) {
+        const G4String magPreset = (mag->GetEmPreset() != "") ? mag->GetEmPreset() : emPresetObject;
+        if (magPreset != "") {
+            EmPresets::ApplyRegion(magPreset, mag->magnetName);
+        }
+    }
 
     MagnetSensorWorldConstruction* magnetSensorWorld =
         new MagnetSensorWorldConstruction("MagnetSensorWorld",physWorld);
@@ -677,6 +1289,12 @@ int main(int argc,char** argv) {
                                                                     rngSeed,
                                                                     beam_eFlat_min,
                                                                     beam_eFlat_max);
+    if (eventReplay != NULL) {
+        gen_action->setReplay(eventReplay);
+    }
+    if (kernelIn != NULL) {
+        gen_action->setKernel(kernelIn);
+    }
     runManager->SetUserAction(gen_action);
     //
     RunAction* run_action = new RunAction;
@@ -684,10 +1302,21 @@ int main(int argc,char** argv) {
     //
     EventAction* event_action = new EventAction(run_action);
     runManager->SetUserAction(event_action);
+    //
+    if (stacking != "") {
+        StackingAction* stacking_action = new StackingAction(stacking);
+        runManager->SetUserAction(stacking_action);
+    }
+    //
+    if (analyticDrift or planeScorer != NULL) {
+        SteppingAction* stepping_action = new SteppingAction(physWorld, virtualTrackerWorld, analyticDrift, planeScorer);
+        runManager->SetUserAction(stepping_action);
+    }
 
     // ** Final initializations **
 
     //Initialize G4 kernel
+    RootFileWriter::GetInstance()->setStartupTimeStart();
     runManager->Initialize();
     //Initialize magnetic fields
     physWorld->PostInitialize();
@@ -698,6 +1327,30 @@ int main(int argc,char** argv) {
     RootFileWriter::GetInstance()->setQuickmode(quickmode);
     RootFileWriter::GetInstance()->setanaScatterTest(anaScatterTest);
     RootFileWriter::GetInstance()->setMiniFile(miniROOTfile);
+    RootFileWriter::GetInstance()->setPerEventTrees(perEventTrees);
+    if (treeFilter != "") {
+        RootFileWriter::GetInstance()->setTreeFilter(treeFilter);
+    }
+    RootFileWriter::GetInstance()->setTreeReservoir(treeReservoir);
+    if (eventTrigger != "") {
+        RootFileWriter::GetInstance()->setEventTrigger(eventTrigger);
+    }
+    RootFileWriter::GetInstance()->setChunkEvents(chunkEvents);
+    RootFileWriter::GetInstance()->setChunkSizeMB(chunkSizeMB);
+    RootFileWriter::GetInstance()->setStatsOnly(statsOnly);
+    if (precision != "") {
+        RootFileWriter::GetInstance()->setPrecision(precision);
+    }
+    RootFileWriter::GetInstance()->setPrecisionBatch(precisionBatch);
+    RootFileWriter::GetInstance()->setCheckpointEvents(checkpointEvents);
+    RootFileWriter::GetInstance()->setCheckpointTime(checkpointTime);
+    RootFileWriter::GetInstance()->setResume(resume);
+    RootFileWriter::GetInstance()->setLiveSnapshotTime(liveSnapshotTime);
+    RootFileWriter::GetInstance()->setProgressFD(progressFD);
+    RootFileWriter::GetInstance()->setProgressInterval(progressInterval);
+    RootFileWriter::GetInstance()->setRecordRNG(recordRNG);
+    RootFileWriter::GetInstance()->setEventIDOffset(eventIDOffset);
+    RootFileWriter::GetInstance()->setAutoRange(autoRange);
     RootFileWriter::GetInstance()->setBeamEnergyCutoff(cutoff_energyFraction);
     RootFileWriter::GetInstance()->setPositionCutoffR(cutoff_radius);
     RootFileWriter::GetInstance()->setEdepDensDZ(edep_dens_dz);
@@ -748,12 +1401,32 @@ int main(int argc,char** argv) {
     }
 
     //Run given number of events
-    if (useGUI==false and numEvents > 0) {
-        G4cout << G4String("'/run/beamOn ") + std::to_string(numEvents) << "'" << G4endl;
-        UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numEvents));
+    G4int numEvents_run = numEvents;
+    if (resume) {
+        if (useGUI or numEvents <= 0) {
+            G4cout << "--resume requires batch mode and a number of events (-n)" << G4endl;
+            exit(1);
+        }
+        // The histograms etc. are restored from the checkpoint at the start of the run
+        Long64_t numEvents_done = RootFileWriter::GetInstance()->GetCheckpointEventCounter();
+        if (numEvents_done >= numEvents) {
+            G4cout << "The checkpoint already has " << numEvents_done << " events"
+                   << " out of -n " << numEvents << "; nothing to resume." << G4endl;
+            exit(1);
+        }
+        numEvents_run = G4int(numEvents - numEvents_done);
+        G4cout << "Resuming after " << numEvents_done << " events, "
+               << numEvents_run << " events remaining." << G4endl;
+    }
+    if (useGUI==false and numEvents_run > 0) {
+        G4cout << G4String("'/run/beamOn ") + std::to_string(numEvents_run) << "'" << G4endl;
+        UImanager->ApplyCommand(G4String("/run/beamOn ") + std::to_string(numEvents_run));
     }
 
     G4cout <<"Done." << G4endl;
+    if (kernelOut != NULL) {
+        kernelOut->CloseForWriting();
+    }
 
     // ** Job termination and cleanup **
 
@@ -771,6 +1444,18 @@ int main(int argc,char** argv) {
     //Cleanup memory
     delete[] argv_effective;
     argv_effective = NULL;
+    if (eventReplay != NULL) {
+        delete eventReplay;
+    }
+    if (kernelIn != NULL) {
+        delete kernelIn;
+    }
+    if (kernelOut != NULL) {
+        delete kernelOut;
+    }
+    if (planeScorer != NULL) {
+        delete planeScorer;
+    }
 
     delete magnetSensorWorld;
     magnetSensorWorld = NULL;
@@ -790,6 +1475,13 @@ void printHelp(G4double target_thick,
                G4double world_size,
                G4String physListName,
                G4double physCutoffDist,
+               G4double targetCut,
+               G4double objectCut,
+               G4double rangeRejection,
+               G4String emPreset,
+               G4String emPresetTarget,
+               G4String emPresetObject,
+               G4bool   targetFastSim,
                G4double beam_energy,
                G4double beam_eFlat_min,
                G4double beam_eFlat_max,
@@ -804,6 +1496,31 @@ void printHelp(G4double target_thick,
                G4bool   quickmode,
                G4bool   anaScatterTest,
                G4bool   miniROOTfile,
+               G4bool   perEventTrees,
+               G4String treeFilter,
+               G4int    treeReservoir,
+               G4String eventTrigger,
+               G4int    chunkEvents,
+               G4double chunkSizeMB,
+               G4bool   statsOnly,
+               G4String precision,
+               G4int    precisionBatch,
+               G4int    checkpointEvents,
+               G4double checkpointTime,
+               G4bool   resume,
+               G4double liveSnapshotTime,
+               G4double maxWallTime,
+               G4int    progressFD,
+               G4double progressInterval,
+               G4String recordRNG,
+               G4String replay,
+               Long64_t eventIDOffset,
+               G4int    autoRange,
+               G4String stacking,
+               G4String writeKernel,
+               G4String readKernel,
+               G4bool   analyticDrift,
+               G4String scorePlanes,
                G4double cutoff_energyFraction,
                G4double cutoff_radius,
                G4double edep_dens_dz,
@@ -848,10 +1565,39 @@ void printHelp(G4double target_thick,
 
             G4cout << "-p <string> : Physics list name,      default/current       = '"
                    << physListName << "'" << G4endl;
+            G4cout << "              'EMonly[_GN][EM option]' is a lightweight list with only EM physics and decays,"
+                   << " '_GN' adds gamma-nuclear, e.g. 'EMonly_EMZ'" << G4endl;
 
             G4cout << "--physCutoffDist <double>: Standard physics cutoff distance [mm], default/current value = "
                    << physCutoffDist << G4endl;
 
+            G4cout << "--targetCut <double>: Physics cutoff distance in the target [mm] (< 0 => --physCutoffDist),"
+                   << " default/current value = " << targetCut << G4endl;
+
+            G4cout << "--objectCut <double>: Physics cutoff distance in the magnets/objects [mm] (< 0 => --physCutoffDist),"
+                   << " can be set per object with the key 'cut', default/current value = " << objectCut << G4endl;
+
+            G4cout << "--rangeRejection <double>: Stop e-/e+ below this kinetic energy [MeV] whose residual range"
+                   << " is shorter than the distance to the nearest volume boundary, in volumes without field,"
+                   << " depositing their energy locally (0 => off), default/current value = " << rangeRejection << G4endl;
+
+            G4cout << "--emPreset <string>: EM physics accuracy/speed preset; 'precise-thin-foil',"
+                   << " 'balanced' (Geant4 standard) or 'fast-shielding', '' => physics list defaults,"
+                   << " default/current value = '" << emPreset << "'" << G4endl;
+
+            G4cout << "--emPresetTarget <string>: EM preset in the target region, using the Geant4 EM models of"
+                   << " the preset ('' => as elsewhere), default/current value = '" << emPresetTarget << "'" << G4endl;
+
+            G4cout << "--emPresetObject <string>: EM preset in the magnets/objects regions, can be set per object"
+                   << " with the key 'emPreset', default/current value = '" << emPresetObject << "'" << G4endl;
+
+            G4cout << "--targetFastSim : Move charged particles through a thin target in one step, sampling the exit angle,"
+                   << " position and energy loss (Moliere screened Rutherford core + single scattering tail, Landau, Bethe-Heitler);" << G4endl
+                   << "                  no delta rays or backscattering. Tracks losing > 5% of their energy are tracked normally." << G4endl
+                   << "                  Experimental: not yet validated against full tracking, compare with"
+                   << " scripts/validateTargetFastSim.py before relying on it, default/current value = "
+                   << (targetFastSim?"true":"false") << G4endl;
+
             G4cout << "-n <int>    : Run a given number of events automatically"
                    << G4endl;
 
@@ -901,6 +1647,135 @@ void printHelp(G4double target_thick,
             G4cout << "-r : miniROOTfile, write small root file with only anlysis output, no TTrees, default/current value = "
                    << (miniROOTfile?"true":"false") << G4endl;
 
+            G4cout << "--perEventTrees : Store the TargetExit and TrackerHits TTrees with one entry per event," << G4endl
+                   << " where each field is an array with one element per hit, default/current value = "
+                   << (perEventTrees?"true":"false") << G4endl;
+
+            G4cout << "--treeFilter key=val(:key=val:...) : Only store hits passing this selection in the TTrees." << G4endl
+                   << " Keys: planes=target,1,2 (tracker numbers and/or 'target'), PDG=11,-11,"
+                   << " Emin/Emax=<double> [MeV], Rmin/Rmax=<double> [mm]." << G4endl
+                   << " Default/current value = '" << treeFilter << "'" << G4endl;
+
+            G4cout << "--treeReservoir <int> : Store at most this many hits per plane in the TTrees," << G4endl
+                   << " as an unbiased random sample of the hits passing the treeFilter in the events passing the --trigger"
+                   << " (0 => store all)." << G4endl
+                   << " The filter statistics (<plane>_treeFilterStats) also count the hits of the events failing the trigger,"
+                   << " default/current value = " << treeReservoir << G4endl;
+
+            G4cout << "--trigger <string> : Only write the TTree entries for events passing this trigger;"
+                   << " the histograms still see all events." << G4endl
+                   << " Conditions are given as 'detector.quantity<op>value' with op one of >,<,>=,<=," << G4endl
+                   << " and combined with '&' (and) and '|' (or), e.g. 'tracker_2.nOutside>0|magnet_1.edep>10'." << G4endl
+                   << " Detectors: 'target', 'tracker' or 'tracker_N', 'magnet_N'." << G4endl
+                   << " Quantities: nHits, nOutside (r >= cutoffRadius), maxR [mm], maxE [MeV], edep [MeV]." << G4endl
+                   << " Default/current value = '" << eventTrigger << "'" << G4endl;
+
+            G4cout << "--chunkEvents <int> : Write the TTrees to numbered files '<filename>_chunkNNNN.root',"
+                   << " starting a new file after this many events (0 => no limit)." << G4endl
+                   << " The event range and number of entries in each file is listed in '<filename>_chunks.txt'," << G4endl
+                   << " default/current value = " << chunkEvents << G4endl;
+
+            G4cout << "--chunkSize <double> : As --chunkEvents, but start a new file when the current one"
+                   << " reaches approximately this size [MB] (0 => no limit), default/current value = "
+                   << chunkSizeMB << G4endl;
+
+            G4cout << "--statsOnly : Only write the Twiss parameters and moments, particle type counts,"
+                   << " target exit angle and energy deposit statistics;" << G4endl
+                   << " no histograms or TTrees are filled, default/current value = "
+                   << (statsOnly?"true":"false") << G4endl;
+
+            G4cout << "--precision phaseSpace:quantity:relErr(,...) : Stop the run when the relative statistical uncertainty"
+                   << " of all these observables is below relErr; -n is then the maximum number of events." << G4endl
+                   << " phaseSpace is the name of a phase space, e.g. 'tracker_1_x' or 'target_exit_cutoff_y'." << G4endl
+                   << " Quantities: eps, beta, posRMS, angRMS, n (particles per event)." << G4endl
+                   << " Default/current value = '" << precision << "'" << G4endl;
+
+            G4cout << "--precisionBatch <int> : Number of events per batch when estimating the uncertainties"
+                   << " for --precision (at least " << PrecisionMonitor::minBatches << " batches are used),"
+                   << " default/current value = " << precisionBatch << G4endl;
+
+            G4cout << "--checkpointEvents <int> : Write the accumulated results and the RNG states to"
+                   << " '<folder>/<filename>_checkpoint.root' every N events (0 => never)."
+                   << " Unless --miniROOTfile or --statsOnly is used, the TTrees must be chunked (--chunkEvents or --chunkSize)." << G4endl
+                   << " Every checkpoint also closes the current TTree chunk file, so the chunks end at the checkpoints"
+                   << " as well as at the --chunkEvents/--chunkSize limits,"
+                   << " default/current value = " << checkpointEvents << G4endl;
+
+            G4cout << "--checkpointTime <double> : Write a checkpoint every T seconds (0 => never)."
+                   << " As for --checkpointEvents, the TTree chunk boundaries then also depend on the timing;"
+                   << " a short interval gives many small chunk files,"
+                   << " default/current value = " << checkpointTime << G4endl;
+
+            G4cout << "--resume : Continue an interrupted run from its checkpoint; use the same arguments as the"
+                   << " original run. The checkpoint is removed when the run completes,"
+                   << " default/current value = " << (resume?"true":"false") << G4endl;
+
+            G4cout << "--liveSnapshot <double> : Every T seconds, write the Twiss parameters, particle counts and"
+                   << " some 1D spectra so far to '<folder>/<filename>_live.root' (0 => never),"
+                   << " default/current value = " << liveSnapshotTime << G4endl;
+
+            G4cout << "--maxWallTime <double> : Stop the run after the event where this wall time [s] is exceeded,"
+                   << " and write the output as usual; leave some margin for writing the output. (0 => no limit)."
+                   << " SIGTERM, SIGINT and SIGUSR1 also stop the run after the current event,"
+                   << " default/current value = " << maxWallTime << G4endl;
+
+            G4cout << "--progressFD <int> : Write progress reports as JSON lines to this (already open) file descriptor,"
+                   << " with the number of events, event rate, ETA, memory use, and hits and hit rates per detector (-1 => disabled),"
+                   << " default/current value = " << progressFD << G4endl;
+
+            G4cout << "--progressInterval <double> : Minimum time between the progress reports [s],"
+                   << " default/current value = " << progressInterval << G4endl;
+
+            G4cout << "--recordRNG <all|trigger> : Store the Geant4 RNG state and the primary particle at the start"
+                   << " of all events, or of the events passing --trigger, in the eventRNG TTree for --replay,"
+                   << " default/current value = '" << recordRNG << "'" << G4endl;
+
+            G4cout << "--replay <file.root(:id1,id2,...)> : Re-simulate the events recorded with --recordRNG in file.root,"
+                   << " or only those with the given eventIDs; -n is set to the number of events."
+                   << " Use a different output filename (-f) than the recording run, and e.g. a macro with"
+                   << " '/tracking/verbose 1' or the GUI (-g) to study the events,"
+                   << " default/current value = '" << replay << "'" << G4endl;
+
+            G4cout << "--eventIDOffset <int> : Added to the eventIDs in the output,"
+                   << " so that the events from several runs (e.g. with different seeds) can be told apart,"
+                   << " default/current value = " << eventIDOffset << G4endl;
+
+            G4cout << "--autoRange <int> : Choose the ranges of the phase space histograms from the first N hits in each,"
+                   << " instead of +/- 10 mm and +/- 5 deg. The ranges are written as <name>_RANGE (0 => fixed ranges),"
+                   << " default/current value = " << autoRange << G4endl;
+
+            G4cout << "--stacking <string> : Kill secondaries before they are tracked, or postpone them to the end of the event."
+                   << " Rules are separated by ';', each rule is key=val pairs separated by ':', e.g."
+                   << " 'PDG=22,11:Emax=0.1;volume=target:dir=backward'."
+                   << " Keys: action=kill|postpone (default kill), PDG, Emin, Emax [MeV],"
+                   << " volume (where the track was created: target, a magnet name or a physical volume name),"
+                   << " dir=forward|backward. The first matching rule applies; 'action=kill' alone tracks only the primaries."
+                   << " The numbers of dropped tracks are written as 'stacking',"
+                   << " default/current value = '" << stacking << "'" << G4endl;
+
+            G4cout << "--writeKernel <string> : Record the particles leaving the target for each primary into a scattering kernel file,"
+                   << " which can later be used with --readKernel. Requires a target without rotation and a beam without flat energy distribution,"
+                   << " and can not be used with checkpointing,"
+                   << " default/current value = '" << writeKernel << "'" << G4endl;
+
+            G4cout << "--readKernel <string> : Instead of tracking the primary through the target, start the particles leaving the target"
+                   << " from a random event of a scattering kernel file made with --writeKernel, rotated around and to the direction of the primary."
+                   << " The target material and thickness, and the beam particle and energy, must be the same as when the kernel was made."
+                   << " The energy deposited in the target is not reproduced,"
+                   << " default/current value = '" << readKernel << "'" << G4endl;
+
+            G4cout << "--analyticDrift : When a stable particle in the world volume has a straight path to the edge of the world"
+                   << " that crosses no object and no magnetic field, record its hits in the tracker planes analytically and stop tracking it."
+                   << " The number of drifted tracks is written as 'analyticDrift',"
+                   << " default/current value = "
+                   << (analyticDrift?"true":"false") << G4endl;
+
+            G4cout << "--scorePlanes <string> : Score the beam in planes without geometry volumes, given as a list 'd1:d2:...'"
+                   << " or an evenly spaced range 'first,last,num' of distances [mm], tilted by the tracker angle (-a)."
+                   << " The crossings are found for each step, and the moments and Twiss parameters of each plane are written"
+                   << " as 'planes_(x|y)[_cutoff]_(MOMENTSMATRIX|TWISSMATRIX)' matrices with one row per plane. Practical for thousands of planes,"
+                   << " default/current value = '" << scorePlanes << "'" << G4endl;
+
             G4cout << "-f <string> : Output filename,        default/current value = "
                    << filename_out << G4endl;
 
@@ -932,6 +1807,11 @@ void printHelp(G4double target_thick,
                    << "     yOffset:   Center offset in Y (<double> [mm]) " << G4endl
                    << "     xRot:      Rotation around horizontal axis (<double> [mm])" << G4endl
                    << "     yRot:      Rotation around vertical axis (<double> [mm])" << G4endl
+                   << "     cut:       Physics cutoff distance in the object's region (<double> [mm], default --objectCut)" << G4endl
+                   << "     minEkin, maxTrackLength, maxTime: Stop all tracks in the object below this kinetic energy" << G4endl
+                   << "                (<double> [MeV]), or above this total track length (<double> [mm]) or time (<double> [ns])," << G4endl
+                   << "                depositing their energy locally. Note that primaries are also affected." << G4endl
+                   << "     emPreset:  EM preset in the object's region (<string>, default --emPresetObject)" << G4endl
                    << "   Note that the offset is applied first," << G4endl
                    << "     then the object is rotated around the offset point." << G4endl
                    << "     The xRot is applied before the yRot." << G4endl
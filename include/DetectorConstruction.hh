@@ -68,6 +68,16 @@ public:
     inline G4double getWorldSizeX()       const {return WorldSizeX;};
     inline G4double getWorldSizeY()       const {return WorldSizeY;};
 
+    // Production cuts in the target region and the magnet/object regions [mm] (< 0 => the default cut)
+    void SetTargetCut(G4double cut) { TargetCut = cut*mm; };
+    void SetObjectCut(G4double cut) { ObjectCut = cut*mm; };
+
+    // Use the TargetFastSimModel for thin targets instead of full tracking
+    void SetTargetFastSim(G4bool targetFastSim) { TargetFastSim = targetFastSim; };
+
+    // True if any object has tracking limits, which need the special cuts process
+    G4bool GetHasUserLimits();
+
 private:
     G4Material*        vacuumMaterial = NULL;
 
@@ -109,6 +119,11 @@ private:
 
     G4double           TargetAngle;
 
+    G4double           TargetCut = -1.0;
+    G4double           ObjectCut = -1.0;
+
+    G4bool             TargetFastSim = false;
+
     G4bool             HasTarget      = false;
     G4Material*        TargetMaterial = NULL;
 
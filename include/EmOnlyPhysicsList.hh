@@ -0,0 +1,39 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EmOnlyPhysicsList_h
+#define EmOnlyPhysicsList_h 1
+
+#include "G4VModularPhysicsList.hh"
+#include "globals.hh"
+
+// Lightweight physics list for pure scattering runs (-p EMonly...), with only
+// electromagnetic physics and decays, skipping the initialization and per-step
+// overhead of the hadronic physics of the reference physics lists.
+// Names are 'EMonly[_GN][EM option]', where '_GN' adds G4EmExtraPhysics
+// (gamma- and lepto-nuclear reactions; the produced hadrons only have EM interactions and decays),
+// and the EM option is one of the reference physics list suffixes, e.g. '_EMZ' for G4EmStandardPhysics_option4.
+class EmOnlyPhysicsList : public G4VModularPhysicsList {
+public:
+    EmOnlyPhysicsList(G4String physListName);
+    virtual ~EmOnlyPhysicsList(){};
+
+    static G4bool IsEmOnlyName(G4String physListName);
+    static void PrintNames();
+};
+
+#endif
@@ -0,0 +1,49 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EmPresets_h
+#define EmPresets_h 1
+
+#include "globals.hh"
+
+#include <vector>
+
+// Named accuracy/speed presets for the electromagnetic physics (--emPreset etc.):
+//  precise-thin-foil : Small multiple scattering steps near boundaries and low tracking thresholds,
+//                      for the angular distributions after thin foils. Slowest.
+//  balanced          : The Geant4 standard EM settings (the default of most reference physics lists).
+//  fast-shielding    : Minimal multiple scattering step limitation and higher tracking thresholds,
+//                      for energy deposition and leakage through thick absorbers. Fastest.
+// Globally the presets set the G4EmParameters, which must be done after the physics list
+// is created (its EM constructor resets them) and before the run manager is initialized.
+// In a region, the EM models of the corresponding Geant4 EM constructor are activated instead,
+// since the G4EmParameters step limitation settings are global.
+// See scripts/benchmarkEmPresets.py for the trade-offs on canonical geometries.
+class EmPresets {
+public:
+    static const std::vector<G4String>& GetPresetNames();
+    // Exits with an error message if the preset does not exist
+    static void CheckPresetName(G4String preset, G4String where);
+
+    static void ApplyGlobal(G4String preset);
+    static void ApplyRegion(G4String preset, G4String regionName);
+
+    // The Geant4 EM constructor used for the preset in a region, e.g. G4EmStandard_opt4
+    static G4String GetRegionPhysics(G4String preset);
+};
+
+#endif
@@ -0,0 +1,56 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTREPLAY_HH
+#define EVENTREPLAY_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "Rtypes.h"
+
+#include <string>
+#include <vector>
+
+// One event as recorded in the eventRNG TTree (see RootFileWriter, --recordRNG):
+// The full state of the Geant4 RNG at the start of the event, and the primary particle.
+struct replayEvent {
+    Long64_t    eventID;
+    std::string rngState;
+    G4double x, xp, y, yp; // [mm], [rad]
+    G4double E;            // [MeV]
+};
+
+// Re-simulation of recorded events (--replay).
+// Defined from a string 'file.root' (all the recorded events in the file)
+// or 'file.root:id1,id2,...' (only the events with these eventIDs).
+class EventReplay {
+public:
+    EventReplay() {};
+
+    void Load(G4String replayString);
+    size_t GetNumEvents() const { return events.size(); };
+
+    // Restore the Geant4 RNG state for the next event, and return its record
+    const replayEvent& Next();
+
+private:
+    std::vector<replayEvent> events;
+    size_t nextEvent = 0;
+};
+
+#endif
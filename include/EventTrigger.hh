@@ -0,0 +1,116 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef EVENTTRIGGER_HH
+#define EVENTTRIGGER_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <map>
+#include <vector>
+
+// Per-event summary of what happened in one detector (target, object or tracker plane)
+struct triggerDetectorSummary {
+    G4int    nHits;    // Number of particles exiting / hitting
+    G4int    nOutside; // Number of particles hitting at r >= position_cutoffR
+    G4double maxR;     // [mm]
+    G4double maxE;     // [MeV]
+    G4double edep;     // [MeV]
+
+    void Reset() {
+        nHits    = 0;
+        nOutside = 0;
+        maxR     = 0.0;
+        maxE     = 0.0;
+        edep     = 0.0;
+    }
+};
+
+// Event-level trigger, evaluated at the end of each event.
+// The expression is a set of conditions 'detector.quantity<op>value',
+// where op is one of '>', '<', '>=', '<='. Conditions are combined with
+// '&' (and) and '|' (or), where '&' binds stronger than '|'. Example:
+//   tracker_2.nOutside>0|magnet_1.edep>10
+// Quantities: nHits, nOutside, maxR [mm], maxE [MeV], edep [MeV].
+class EventTrigger {
+public:
+    EventTrigger() {};
+
+    void Parse(G4String triggerString);
+    G4bool IsActive() const { return active; };
+    const G4String& GetDefinition() const { return definition; };
+
+    // Register a detector that can be used in the expression; returns the detector index.
+    G4int RegisterDetector(G4String name);
+    // Map the detector names in the expression to the registered detectors.
+    void Resolve();
+
+    void SetPositionCutoffR(G4double cutR) { position_cutoffR = cutR; };
+
+    // Called from RootFileWriter::doEvent()
+    void Reset() {
+        for (auto& s : summaries) s.Reset();
+    };
+    void AddHit(G4int detIdx, G4double E, G4double R) {
+        triggerDetectorSummary& s = summaries[detIdx];
+        s.nHits++;
+        if (R >= position_cutoffR) s.nOutside++;
+        if (R > s.maxR) s.maxR = R;
+        if (E > s.maxE) s.maxE = E;
+    };
+    void AddEdep(G4int detIdx, G4double edep) {
+        summaries[detIdx].edep += edep;
+    };
+    G4bool Evaluate();
+
+    G4long GetNumEvaluated() const { return numEvaluated; };
+    G4long GetNumPassed()    const { return numPassed; };
+    // Used when resuming from a checkpoint
+    void SetCounters(G4long numEvaluated_in, G4long numPassed_in) {
+        numEvaluated = numEvaluated_in;
+        numPassed    = numPassed_in;
+    };
+
+private:
+    enum triggerQuantity { NHITS, NOUTSIDE, MAXR, MAXE, EDEP };
+    enum triggerOperator { GT, LT, GE, LE };
+    struct triggerCondition {
+        G4String        detName;
+        G4int           detIdx;
+        triggerQuantity quantity;
+        triggerOperator op;
+        G4double        value;
+    };
+    triggerCondition ParseCondition(G4String condString);
+
+    G4String definition = "";
+    G4bool   active     = false;
+
+    // OR of clauses, each clause is an AND of conditions
+    std::vector<std::vector<triggerCondition>> clauses;
+
+    std::map<G4String,G4int> detectorIndex;
+    std::vector<triggerDetectorSummary> summaries;
+
+    G4double position_cutoffR = 1.0; // [mm]
+
+    G4long numEvaluated = 0;
+    G4long numPassed    = 0;
+};
+
+#endif
@@ -20,6 +20,8 @@
 #include "G4SystemOfUnits.hh"
 
 #include "DetectorConstruction.hh"
+
+#include <cfloat>
 //#include "FieldClasses.hh"
 
 // For the field classes
@@ -95,6 +97,17 @@ protected:
     G4double xOffset = 0.0; // [G4 length units]
     G4double yOffset = 0.0; // [G4 length units]
 
+    // Production cut in the region of this magnet/object [G4 length units] (< 0 => --objectCut or default)
+    G4double regionCut = -1.0;
+    // Tracking limits in the region, set as G4UserLimits; tracks beyond them are stopped
+    // and deposit their kinetic energy locally, through G4UserSpecialCuts
+    G4bool   hasUserLimits  = false;
+    G4double minEkin        = 0.0;     // [G4 energy units]
+    G4double maxTrackLength = DBL_MAX; // [G4 length units]
+    G4double maxTime        = DBL_MAX; // [G4 time units]
+    // EM preset in the region (see EmPresets.hh); empty => --emPresetObject or the physics list
+    G4String emPreset = "";
+
     //Rotations are applied after moving, around the new position
     G4double xRot = 0.0; // Rotation around horizontal axis [G4 angle units]
     G4double yRot = 0.0; // Rotation around vertical axis   [G4 angle units]
@@ -127,10 +140,18 @@ public:
     G4LogicalVolume* GetMainLV() const;
     G4LogicalVolume* GetDetectorLV() const;
     void AddSD(); // Adds an SD to the detectorLV
+    // Put the mainLV in its own G4Region, named after the magnet.
+    // defaultCut [G4 length units] is used if the magnet has no 'cut' key (< 0 => the default cut).
+    void MakeRegion(G4double defaultCut);
+    G4bool HasUserLimits() const { return hasUserLimits; };
+    G4String GetEmPreset() const { return emPreset; };
 
 public:
     //Parsing helpers
     void ParseOffsetRot(G4String k, G4String v);
+    void ParseRegionCut(G4String v);
+    void ParseUserLimits(G4String k, G4String v);
+    void ParseEmPreset(G4String v);
 
     G4bool   ParseBool  (G4String inStr, G4String readWhat);
     G4double ParseDouble(G4String inStr, G4String readWhat);
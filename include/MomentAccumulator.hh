@@ -0,0 +1,108 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef MOMENTACCUMULATOR_HH
+#define MOMENTACCUMULATOR_HH 1
+
+#include "globals.hh"
+
+#include "TVectorD.h"
+
+#include <cmath>
+
+// Streaming first and second moments of a pair of variables (u,v),
+// e.g. position and angle in one plane, updated with Welford's algorithm.
+// This avoids the catastrophic cancellation of the sum-of-squares formulas,
+// and does not need a histogram.
+// Accumulators filled separately can be merged exactly (Chan et al.).
+class MomentAccumulator2D {
+public:
+    MomentAccumulator2D() {};
+
+    void Fill(G4double u, G4double v) {
+        n++;
+        const G4double du = u - meanU;
+        const G4double dv = v - meanV;
+        meanU += du / n;
+        meanV += dv / n;
+        M2U   += du * (u - meanU);
+        M2V   += dv * (v - meanV);
+        CUV   += du * (v - meanV);
+    };
+    void Merge(const MomentAccumulator2D& other);
+    void Reset() {
+        n = 0;
+        meanU = meanV = M2U = M2V = CUV = 0.0;
+    };
+
+    G4long   GetN()     const { return n; };
+    G4double GetMeanU() const { return meanU; };
+    G4double GetMeanV() const { return meanV; };
+    // Sample (co)variances, i.e. divided by (n-1)
+    G4double GetVarU()  const { return n > 1 ? M2U / (n-1) : NAN; };
+    G4double GetVarV()  const { return n > 1 ? M2V / (n-1) : NAN; };
+    G4double GetCovUV() const { return n > 1 ? CUV / (n-1) : NAN; };
+
+    // Raw state [n, meanU, meanV, M2U, M2V, CUV], for storing and merging
+    static const G4int numRawMoments = 6;
+    TVectorD GetRawMoments() const;
+    void     SetRawMoments(const TVectorD& raw);
+
+private:
+    G4long   n     = 0;
+    G4double meanU = 0.0;
+    G4double meanV = 0.0;
+    G4double M2U   = 0.0; // Sum of (u-meanU)^2
+    G4double M2V   = 0.0; // Sum of (v-meanV)^2
+    G4double CUV   = 0.0; // Sum of (u-meanU)*(v-meanV)
+};
+
+// Running sum with Neumaier's variant of Kahan compensated summation,
+// keeping the rounding error of each addition in a separate term.
+// The error of the sum then does not grow with the number of terms,
+// which matters when adding up values over billions of events.
+class CompensatedSum {
+public:
+    CompensatedSum(G4double value = 0.0) : sum(value) {};
+
+    void Add(G4double x) {
+        const G4double t = sum + x;
+        if (std::fabs(sum) >= std::fabs(x)) {
+            comp += (sum - t) + x;
+        }
+        else {
+            comp += (x - t) + sum;
+        }
+        sum = t;
+    };
+    CompensatedSum& operator+=(G4double x) { Add(x); return *this; };
+    CompensatedSum& operator=(G4double value) { sum = value; comp = 0.0; return *this; };
+
+    G4double Get() const { return sum + comp; };
+    operator G4double() const { return Get(); };
+
+    // The two terms, for storing and restoring the exact state
+    G4double GetSum()  const { return sum; };
+    G4double GetComp() const { return comp; };
+    void     Set(G4double sum_in, G4double comp_in) { sum = sum_in; comp = comp_in; };
+
+private:
+    G4double sum  = 0.0;
+    G4double comp = 0.0; // Accumulated rounding errors
+};
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PlaneScorer_h
+#define PlaneScorer_h 1
+
+#include "G4String.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include "MomentAccumulator.hh"
+
+#include "TMatrixD.h"
+
+#include <vector>
+
+class G4Step;
+class G4ParticleDefinition;
+
+// Scoring planes without geometry volumes (--scorePlanes), for studies with many planes.
+// The planes are tilted by the same angle around the y axis as the trackers (-a),
+// and plane i passes through (0,0,distance_i). Each step is checked for the planes it crosses
+// by a binary search in the sorted plane positions, and the crossings are filled directly
+// into per-plane accumulators; there are no hit collections or TTrees.
+// The position, momentum and energy at the crossing are interpolated linearly along the step.
+class PlaneScorer {
+public:
+    // The planes are given as a list 'd1:d2:...' or as an evenly spaced range 'first,last,num' [mm]
+    PlaneScorer(G4String planesString, G4double angle_in);
+    ~PlaneScorer(){};
+
+    // The cuts used for the _cutoff accumulators, as for the trackers; energy [MeV], radius [mm]
+    void SetCutoffs(G4double energyCut_in, G4double radiusCut_in) {
+        energyCut = energyCut_in; radiusCut = radiusCut_in;
+    };
+    void Reset();
+
+    void ScoreStep(const G4Step* step);
+    // Score a straight segment from pos0 to pos1, with momentum and kinetic energy at both ends [G4 units]
+    void ScoreSegment(const G4ThreeVector& pos0, const G4ThreeVector& pos1,
+                      const G4ThreeVector& mom0, const G4ThreeVector& mom1,
+                      G4double E0, G4double E1, const G4ParticleDefinition* particleType);
+
+    size_t GetNumPlanes() const { return planeDistances.size(); };
+    const std::vector<G4double>& GetDistances() const { return planeDistances; }; // [G4 units]
+    std::vector<G4double> GetDistances_mm() const;
+    G4long GetNumHits(size_t idx) const { return numHits[idx]; };
+
+    // Phase space (position [mm], angle [rad]) of all particles and of the charged particles
+    // passing the cuts, in x and y
+    const MomentAccumulator2D& GetMomentsX(size_t idx)        const { return momentsX[idx]; };
+    const MomentAccumulator2D& GetMomentsY(size_t idx)        const { return momentsY[idx]; };
+    const MomentAccumulator2D& GetMomentsX_cutoff(size_t idx) const { return momentsX_cutoff[idx]; };
+    const MomentAccumulator2D& GetMomentsY_cutoff(size_t idx) const { return momentsY_cutoff[idx]; };
+
+    // The accumulated state, for the checkpoints: One row per plane,
+    // [numHits, raw moments of x, y, x_cutoff and y_cutoff]
+    TMatrixD GetState() const;
+    void     SetState(const TMatrixD& state);
+
+private:
+    std::vector<G4double> planeDistances; // Sorted [G4 units]
+    std::vector<G4double> planePos;       // Position of each plane along the normal [G4 units]
+    G4double angle;                       // [G4 units]
+    G4ThreeVector normal;
+
+    G4double energyCut = 0.0; // [MeV]
+    G4double radiusCut = 0.0; // [mm]
+
+    std::vector<G4long> numHits;
+    std::vector<MomentAccumulator2D> momentsX;
+    std::vector<MomentAccumulator2D> momentsY;
+    std::vector<MomentAccumulator2D> momentsX_cutoff;
+    std::vector<MomentAccumulator2D> momentsY_cutoff;
+};
+
+#endif
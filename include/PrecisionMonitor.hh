@@ -0,0 +1,105 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef PRECISIONMONITOR_HH
+#define PRECISIONMONITOR_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include "MomentAccumulator.hh"
+
+#include "TVectorD.h"
+
+#include <map>
+#include <vector>
+
+// Estimates the statistical uncertainty of selected observables during the run,
+// using the method of batch means, so that the run can be stopped once the
+// requested relative uncertainty is reached.
+// Defined from a string of comma-separated targets 'phaseSpace:quantity:relErr', e.g.
+//   tracker_1_x:eps:0.01,tracker_1_cutoff_x:n:0.005
+// where phaseSpace is the name of a position/angle phase space (e.g. init_x,
+// target_exit_cutoff_y, tracker_2_x, magnet_1_cutoff_x_PDG11).
+// Quantities: eps (geometrical emittance), beta, posRMS, angRMS,
+// and n (number of particles in the phase space per event, e.g. the transmitted fraction).
+class PrecisionMonitor {
+public:
+    PrecisionMonitor() {};
+
+    void Parse(G4String precisionString);
+    void Print() const;
+
+    G4bool IsActive() const { return active; };
+    const G4String& GetDefinition() const { return definition; };
+
+    void  SetBatchSize(G4int batchSize_arg) { batchSize = batchSize_arg; };
+    G4int GetBatchSize() const { return batchSize; };
+
+    size_t GetNumTargets() const { return targets.size(); };
+    // The phaseSpaceAccumulator with this name fills these batch moments
+    std::vector<G4String> GetPhaseSpaceNames() const;
+    MomentAccumulator2D* GetBatchMoments(const G4String& phaseSpaceName) {
+        return &(batchMoments[phaseSpaceName]);
+    };
+
+    // Called at the end of each event; closes the batch when it is full.
+    void EndOfEvent();
+    G4bool IsConverged() const { return converged; };
+
+    // Name '<phaseSpace>_<quantity>' and [requested relErr, achieved relErr, mean of batches, numBatches, batchSize]
+    G4String GetTargetName(size_t i) const;
+    TVectorD GetResult(size_t i) const;
+
+    // Internal state, used for checkpointing:
+    // [batchEvents, converged, (numBatches, batchMean, batchM2) per target, raw batch moments per phase space]
+    TVectorD GetState() const;
+    void SetState(const TVectorD& state);
+
+    static const G4int minBatches = 10;
+
+private:
+    enum precisionQuantity { EPS, BETA, POSRMS, ANGRMS, NPART };
+
+    struct precisionTarget {
+        G4String          phaseSpaceName;
+        G4String          quantityName;
+        precisionQuantity quantity;
+        G4double          relErr_target;
+
+        // Welford accumulation of the batch values
+        G4long   numBatches = 0;
+        G4double batchMean  = 0.0;
+        G4double batchM2    = 0.0;
+
+        G4double GetRelErr() const;
+    };
+    precisionTarget ParseTarget(G4String targetString);
+    G4double ComputeBatchValue(const precisionTarget& target) const;
+
+    G4String definition = "";
+    G4bool   active     = false;
+
+    std::vector<precisionTarget> targets;
+    std::map<G4String,MomentAccumulator2D> batchMoments; // One per phase space in the current batch
+
+    G4int  batchSize        = 1000;
+    G4int  batchEvents      = 0;
+    G4bool converged        = false;
+};
+
+#endif
@@ -31,6 +31,11 @@
 
 #include "TRandom.h"
 
+#include "EventReplay.hh"
+#include "ScatterKernel.hh"
+
+#include <string>
+
 class G4ParticleGun;
 class G4Event;
 class DetectorConstruction;
@@ -59,6 +64,22 @@ public:
     G4double get_beam_particlemass()   const { return particle->GetPDGMass(); };
     G4double get_beam_particlecharge() const { return particle->GetPDGCharge(); };
 
+    // The RNG used for the beam distribution, which may be NULL if it is not needed.
+    // SetRNG() is used when resuming from a checkpoint, and takes ownership.
+    TRandom* GetRNG() const { return RNG; };
+    void     SetRNG(TRandom* RNG_in);
+
+    // Save the Geant4 RNG state at the start of each event, for the eventRNG TTree (--recordRNG)
+    void setRecordRNGState(G4bool recordRNGState_in) { recordRNGState = recordRNGState_in; };
+    const std::string& GetEventRNGState() const { return eventRNGState; };
+    // Generate the recorded events instead of sampling the beam (--replay)
+    void setReplay(EventReplay* replay_in) { replay = replay_in; };
+    // Generate the particles leaving the target from a scattering kernel,
+    // instead of tracking the primary through the target (--readKernel)
+    void setKernel(ScatterKernel* kernel_in) { kernel = kernel_in; };
+
+    G4double get_beam_zpos() const { return beam_zpos; }; // [G4 units]
+
     static G4double GetDefaultZpos(G4double targetThickness_in) {
         G4double beam_zpos = targetThickness_in / 2.0;
         // Round up to nearest 10 mm
@@ -108,9 +129,14 @@ private:
     //Setup for circular uniform distribution / Rcut
     G4double Rcut; // [mm]
 
-    TRandom* RNG;
+    TRandom* RNG = NULL;
     G4int rngSeed; // Seed to use when random-generating particles within Twiss distribution
 
+    G4bool      recordRNGState = false;
+    std::string eventRNGState;
+    EventReplay* replay = NULL;
+    ScatterKernel* kernel = NULL;
+
     //Setup for uniform energy distribution between min/max
     G4double beam_energy_min; // [MeV]
     G4double beam_energy_max; // [MeV]
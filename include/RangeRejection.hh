@@ -0,0 +1,69 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RangeRejection_h
+#define RangeRejection_h 1
+
+#include "G4VDiscreteProcess.hh"
+#include "G4VPhysicsConstructor.hh"
+#include "globals.hh"
+
+class RunCounters;
+
+// Electron range rejection (--rangeRejection): an e-/e+ below a kinetic energy threshold,
+// in a volume without a magnetic field, whose residual range is shorter than its safety
+// distance to the nearest volume boundary can never leave the volume. It is then stopped,
+// and its kinetic energy is deposited locally in a zero-length step, so that it is still
+// scored by the sensitive detectors (TargetSD, the magnet edep).
+// Electrons are killed, positrons are stopped so that they still annihilate at rest.
+// The bremsstrahlung photons the track could have emitted on the way are neglected,
+// which is what the energy threshold is for.
+// The stopped tracks are counted in the RunCounters 'rangeRejection'.
+class RangeRejection : public G4VDiscreteProcess {
+public:
+    RangeRejection(G4double Emax_arg, const G4String& processName = "RangeRejection");
+    virtual ~RangeRejection(){};
+
+    virtual G4double PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                          G4double previousStepSize,
+                                                          G4ForceCondition* condition);
+    virtual G4VParticleChange* PostStepDoIt(const G4Track& track, const G4Step& step);
+
+protected:
+    virtual G4double GetMeanFreePath(const G4Track&, G4double, G4ForceCondition*) { return DBL_MAX; };
+
+private:
+    G4double Emax; // Only tracks below this kinetic energy are considered [MeV]
+
+    RunCounters* counters = NULL; // Shared by the e- and e+ processes
+};
+
+// Adds RangeRejection to e- and e+
+class RangeRejectionPhysics : public G4VPhysicsConstructor {
+public:
+    RangeRejectionPhysics(G4double Emax_arg) :
+        G4VPhysicsConstructor("RangeRejectionPhysics"), Emax(Emax_arg) {};
+    virtual ~RangeRejectionPhysics(){};
+
+    virtual void ConstructParticle(){};
+    virtual void ConstructProcess();
+
+private:
+    G4double Emax; // [MeV]
+};
+
+#endif
@@ -25,6 +25,17 @@
 #include "TH2.h"
 #include "TH3.h"
 #include <map>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <csignal>
+
+#include "TreeHitFilter.hh"
+#include "MomentAccumulator.hh"
+#include "PrecisionMonitor.hh"
+#include "EventTrigger.hh"
+#include "ScatterKernel.hh"
+#include "PlaneScorer.hh"
 
 class TRandom;
 
@@ -44,7 +55,131 @@ struct trackerHitStruct {
     Int_t PDG;
     Int_t charge;
 
-    Int_t eventID;
+    Long64_t eventID; // Includes --eventIDOffset
+};
+
+// Same content as trackerHitStruct, but collecting all the hits in an event
+// into one TTree entry with one variable-length array per field.
+// Only std::vector of basic types is used, so this also requires no dictionary to read.
+struct trackerHitEventStruct {
+    Long64_t eventID;
+
+    std::vector<Double_t> x;  // [mm]
+    std::vector<Double_t> y;  // [mm]
+    std::vector<Double_t> z;  // [mm]
+
+    std::vector<Double_t> px; // [MeV/c]
+    std::vector<Double_t> py; // [MeV/c]
+    std::vector<Double_t> pz; // [MeV/c]
+
+    std::vector<Double_t> E;  // [MeV]
+
+    std::vector<Int_t> PDG;
+    std::vector<Int_t> charge;
+
+    void clear() {
+        x.clear(); y.clear(); z.clear();
+        px.clear(); py.clear(); pz.clear();
+        E.clear();
+        PDG.clear(); charge.clear();
+    }
+    void push_back(const trackerHitStruct& hit) {
+        x.push_back(hit.x); y.push_back(hit.y); z.push_back(hit.z);
+        px.push_back(hit.px); py.push_back(hit.py); pz.push_back(hit.pz);
+        E.push_back(hit.E);
+        PDG.push_back(hit.PDG); charge.push_back(hit.charge);
+    }
+};
+
+// Bookkeeping of what is written to the hit TTrees from one plane
+struct hitTreePlaneStats {
+    G4String name;
+    Long64_t numHits          = 0; // Hits seen on the plane, in all events
+    Long64_t numTriggerFailed = 0; // Hits in events failing the trigger, not given to the filter
+    Long64_t numPassed        = 0; // Hits in events passing the trigger and passing the tree filter
+    Long64_t numStored        = 0; // Hits written to the TTree
+    // Hits kept by reservoir sampling among the numPassed hits, written at the end of the run
+    std::vector<trackerHitStruct> reservoir;
+};
+
+// One line in the index file for the TTree chunk files
+struct chunkIndexEntry {
+    G4String fileName;
+    Long64_t firstEvent;
+    Long64_t lastEvent;
+    Long64_t targetExitEntries;
+    Long64_t trackerHitsEntries;
+    Long64_t magnetEdepsEntries;
+};
+
+// One entry in the eventRNG TTree, read by EventReplay
+struct eventRNGStruct {
+    Long64_t    eventID;
+    std::string rngState; // From G4Random::saveFullState() at the start of the event
+    Double_t    x, xp, y, yp; // Primary particle [mm], [rad]
+    Double_t    E;            // [MeV]
+};
+
+// Phase space (position [mm], angle [rad]) in one plane and cut class.
+// The moments used for the Twiss parameters are always accumulated;
+// the histogram is optional (NULL in quickmode, where it would not be written).
+// With --autoRange, the first warmupSize hits are buffered, the histogram ranges
+// are chosen from their quantiles, and then the buffer is filled into the histogram.
+struct phaseSpaceAccumulator {
+    G4String name;
+    G4String title;
+    MomentAccumulator2D moments;
+    TH2D* hist = NULL;
+    MomentAccumulator2D* batchMoments = NULL; // Owned by the PrecisionMonitor, if used
+
+    size_t warmupSize = 0; // 0 => fixed ranges, or the warm-up is done
+    std::vector<std::pair<G4double,G4double>> warmup;
+    G4bool autoRanged = false;
+    size_t numWarmupHits = 0; // Number of hits the ranges were chosen from
+    static const G4double autoRange_quantile; // The range covers the quantiles [q, 1-q] of the warm-up hits,
+    static const G4double autoRange_margin;   // widened by this fraction of its width on both sides
+
+    ~phaseSpaceAccumulator() {
+        if (hist != NULL) {
+            delete hist;
+        }
+    };
+
+    void Fill(G4double pos, G4double ang) {
+        moments.Fill(pos, ang);
+        if (batchMoments != NULL) {
+            batchMoments->Fill(pos, ang);
+        }
+        if (hist != NULL) {
+            if (warmupSize > 0) {
+                warmup.push_back(std::make_pair(pos, ang));
+                if (warmup.size() >= warmupSize) {
+                    EndWarmup();
+                }
+            }
+            else {
+                hist->Fill(pos, ang);
+            }
+        }
+    };
+    // Choose the ranges from the hits buffered so far, and fill them into the histogram
+    void EndWarmup();
+    // Set the ranges and stop buffering (the histogram must be empty)
+    void SetRange(G4double posMin, G4double posMax, G4double angMin, G4double angMax);
+    void SetAxisTitles(const char* xTitle, const char* yTitle) {
+        if (hist != NULL) {
+            hist->GetXaxis()->SetTitle(xTitle);
+            hist->GetYaxis()->SetTitle(yTitle);
+        }
+    };
+};
+
+// Size and timing of one object written to the ROOT file
+struct writeManifestEntry {
+    G4String name;
+    G4String className;
+    Int_t    nbytes;
+    G4double writeTime; // [s]
 };
 
 class particleTypesCounter {
@@ -55,9 +190,9 @@ public:
         numParticles = 0;
     }
     // In both cases, the index is the PDG id.
-    std::map<G4int,G4int> particleTypes;    // The number of particles of each type
+    std::map<G4int,Long64_t> particleTypes; // The number of particles of each type
     std::map<G4int,G4String> particleNames; // The name of each particle type
-    G4int numParticles;
+    Long64_t numParticles;
 };
 
 class RootFileWriter {
@@ -89,6 +224,87 @@ public:
     void setMiniFile(G4bool miniFile_arg) {
         this->miniFile = miniFile_arg;
     };
+    void setPerEventTrees(G4bool perEventTrees_arg) {
+        this->perEventTrees = perEventTrees_arg;
+    };
+    void setAutoRange(G4int autoRange_arg) {
+        this->autoRange = autoRange_arg;
+    };
+    void setTreeFilter(G4String treeFilter_arg) {
+        this->treeFilter.Parse(treeFilter_arg);
+    };
+    void setTreeReservoir(G4int treeReservoir_arg);
+    void setEventTrigger(G4String eventTrigger_arg) {
+        this->eventTrigger.Parse(eventTrigger_arg);
+    };
+    void setRecordRNG(G4String recordRNG_arg) {
+        this->recordRNG = recordRNG_arg;
+    };
+    // Record the particles leaving the target for each event (--writeKernel); not owned
+    void setKernelWriter(ScatterKernel* kernelWriter_arg) {
+        this->kernelWriter = kernelWriter_arg;
+    };
+    // Scoring planes without geometry volumes (--scorePlanes), filled by the SteppingAction; not owned
+    void setPlaneScorer(PlaneScorer* planeScorer_arg) {
+        this->planeScorer = planeScorer_arg;
+    };
+    void setChunkEvents(G4int chunkEvents_arg) {
+        this->chunkEvents = chunkEvents_arg;
+    };
+    void setChunkSizeMB(G4double chunkSizeMB_arg) {
+        this->chunkSizeMB = chunkSizeMB_arg;
+    };
+    void setStatsOnly(G4bool statsOnly_arg) {
+        this->statsOnly = statsOnly_arg;
+    };
+    void setPrecision(G4String precision_arg) {
+        this->precision.Parse(precision_arg);
+    };
+    void setPrecisionBatch(G4int precisionBatch_arg) {
+        this->precision.SetBatchSize(precisionBatch_arg);
+    };
+
+    void setCheckpointEvents(G4int checkpointEvents_arg) {
+        this->checkpointEvents = checkpointEvents_arg;
+    };
+    void setCheckpointTime(G4double checkpointTime_arg) {
+        this->checkpointTime = checkpointTime_arg;
+    };
+    void setResume(G4bool resume_arg) {
+        this->resume = resume_arg;
+    };
+    void setLiveSnapshotTime(G4double liveSnapshotTime_arg) {
+        this->liveSnapshotTime = liveSnapshotTime_arg;
+    };
+    void setProgressFD(G4int progressFD_arg) {
+        this->progressFD = progressFD_arg;
+    };
+    void setProgressInterval(G4double progressInterval_arg) {
+        this->progressInterval = progressInterval_arg;
+    };
+    // Number of events already simulated according to the checkpoint file, used for --resume.
+    // Requires the file- and folder names to be set.
+    Long64_t GetCheckpointEventCounter();
+
+    // True when all the --precision targets have been reached, and the run can stop
+    G4bool PrecisionReached() const {
+        return precision.IsActive() and precision.IsConverged();
+    };
+
+    void setMaxWallTime(G4double maxWallTime_arg) {
+        // The wall time is counted from when this is called, before Geant4 is initialized
+        this->maxWallTime   = maxWallTime_arg;
+        this->wallTimeStart = std::chrono::steady_clock::now();
+    };
+    // Startup = Geant4 initialization and building the physics tables, until the run starts
+    void setStartupTimeStart() {
+        this->startupTimeStart = std::chrono::steady_clock::now();
+    };
+    // True when the run should stop after the current event: When the --precision targets are reached,
+    // --maxWallTime is exceeded, or a stop signal has been received. The reason is kept for the metadata.
+    G4bool StopRequested();
+    // Handler for SIGTERM, SIGINT and SIGUSR1, installed in main()
+    static void HandleStopSignal(int signum);
 
     void setBeamEnergyCutoff(G4double cutFrac){
         this->beamEnergy_cutoff = cutFrac;
@@ -97,9 +313,12 @@ public:
         this->position_cutoffR = cutR;
     }
 
-    void setNumEvents(G4int numEvents_in) {
+    void setNumEvents(Long64_t numEvents_in) {
         this->numEvents = numEvents_in;
     }
+    void setEventIDOffset(Long64_t eventIDOffset_in) {
+        this->eventIDOffset = eventIDOffset_in;
+    }
 
     void setEdepDensDZ(G4double edep_dens_dz_in) {
         this->edep_dens_dz = edep_dens_dz_in;
@@ -126,8 +345,89 @@ private:
     TTree* trackerHits                                                          = NULL;
     trackerHitStruct targetExitBuffer;
     trackerHitStruct trackerHitsBuffer;
+    // Used instead of the per-hit buffers if perEventTrees is set
+    trackerHitEventStruct targetExitEventBuffer;
+    trackerHitEventStruct trackerHitsEventBuffer;
+
+    // Hits destined for the TTrees, collected over the current event
+    std::vector<trackerHitStruct> targetExitStaging;
+    std::vector<std::vector<trackerHitStruct>> trackerHitsStaging; // [trackerIdx][hit]
+
+    // Write-time selection of the hits going to the TTrees
+    TreeHitFilter treeFilter;
+    G4int treeReservoir = 0; // Max number of hits stored per plane, 0 => no limit
+    std::vector<hitTreePlaneStats> hitTreeStats; // [0] = target, [1..N] = trackers
+
+    // Only events passing this are written to the TTrees (if active)
+    EventTrigger eventTrigger;
+    G4int triggerIdx_target = -1;
+    std::vector<G4int> triggerIdx_trackers;
+    std::vector<G4int> triggerIdx_magnets;
+
+    // Per-event RNG states for replaying events ("all", "trigger" or "" => disabled)
+    G4String recordRNG = "";
+    TTree* eventRNG = NULL;
+    eventRNGStruct eventRNGBuffer;
+
+    ScatterKernel* kernelWriter = NULL;
+    PlaneScorer*   planeScorer  = NULL;
+
+    // Rollover of the TTrees into numbered chunk files (if chunkEvents or chunkSizeMB > 0)
+    G4int    chunkEvents = 0;   // Max number of events per chunk
+    G4double chunkSizeMB = 0.0; // Approximate max size of each chunk [MB]
+    TFile*   chunkFile = NULL;
+    G4String chunkFileName;
+    G4String chunkIndexFileName;
+    G4int    chunkNumber;
+    Long64_t chunkFirstEvent;
+    Long64_t chunkNumEvents;
+    std::vector<chunkIndexEntry> chunkIndex;
+
+    // Only keep the scalar accumulators (no histograms or TTrees)
+    G4bool statsOnly = false;
+    // Energy deposit per event, summed over events (statsOnly mode) [MeV]
+    CompensatedSum target_edep_sum;
+    CompensatedSum target_edep_sum2;
+    std::vector<CompensatedSum> magnet_edep_sum;
+    std::vector<CompensatedSum> magnet_edep_sum2;
+
+    // Stop the run when the requested statistical precision is reached
+    PrecisionMonitor precision;
+
+    // Periodic checkpoints of the accumulated results and RNG states, for --resume
+    G4int    checkpointEvents = 0;   // Write a checkpoint every N events (0 => never)
+    G4double checkpointTime   = 0.0; // Write a checkpoint every T seconds (0 => never) [s]
+    G4bool   resume           = false;
+    G4String checkpointFileName;
+    std::chrono::steady_clock::time_point lastCheckpointTime;
+
+    // Progress reports as JSON lines, written to a file descriptor
+    G4int    progressFD       = -1;  // File descriptor to write to (-1 => disabled)
+    G4double progressInterval = 1.0; // Minimum time between reports [s]
+    std::chrono::steady_clock::time_point lastProgressTime;
+    Long64_t lastProgressEvents;     // eventCounter at the last report (-1 => not yet set)
+    std::map<G4String,Long64_t> lastProgressHits; // typeCounter numParticles at the last report
+
+    // Stopping the run before numEvents
+    enum stopReasons { STOP_NONE = 0, STOP_PRECISION = 1, STOP_WALLTIME = 2, STOP_SIGNAL = 3 };
+    G4int    stopReason  = STOP_NONE;
+    G4double maxWallTime = 0.0; // [s] (0 => no limit)
+    std::chrono::steady_clock::time_point wallTimeStart;
+    static volatile sig_atomic_t stopSignal; // Number of the last stop signal received, or 0
+
+    // Periodic snapshot of the Twiss parameters, particle counts and some spectra while running
+    G4double liveSnapshotTime = 0.0; // Write a snapshot every T seconds (0 => never) [s]
+    G4String liveSnapshotFileName;
+    std::chrono::steady_clock::time_point lastLiveSnapshotTime;
+    std::chrono::steady_clock::time_point runStartTime;
+    std::chrono::steady_clock::time_point startupTimeStart;
+    G4double startupTime = 0.0; // [s]
+
+    // Objects written by finalizeRootFile(), stored as the writeManifest TTree
+    std::vector<writeManifestEntry> writeManifest;
 
     Double_t* magnetEdepsBuffer                                                 = NULL;
+    Long64_t  magnetEdepsEventID                                                = 0; // Includes --eventIDOffset
     TTree* magnetEdeps                                                          = NULL;
 
     // Histograms //
@@ -143,10 +443,10 @@ private:
     TH1D* target_exitangle_hist                                                 = NULL;
     TH1D* target_exitangle_hist_cutoff                                          = NULL;
 
-    TH2D* target_exit_phasespaceX                                               = NULL;
-    TH2D* target_exit_phasespaceY                                               = NULL;
-    TH2D* target_exit_phasespaceX_cutoff                                        = NULL;
-    TH2D* target_exit_phasespaceY_cutoff                                        = NULL;
+    phaseSpaceAccumulator* target_exit_phasespaceX                              = NULL;
+    phaseSpaceAccumulator* target_exit_phasespaceY                              = NULL;
+    phaseSpaceAccumulator* target_exit_phasespaceX_cutoff                       = NULL;
+    phaseSpaceAccumulator* target_exit_phasespaceY_cutoff                       = NULL;
     TH2D* target_exit_phasespaceXY                                              = NULL;
     TH2D* target_exit_phasespaceXY_cutoff                                       = NULL;
   
@@ -163,12 +463,12 @@ private:
 
     std::vector<std::map<G4int,TH1D*>> magnet_exit_Rpos;
     std::vector<std::map<G4int,TH1D*>> magnet_exit_Rpos_cutoff;
-    std::vector<TH2D*> magnet_exit_phasespaceX;
-    std::vector<TH2D*> magnet_exit_phasespaceY;
-    std::vector<TH2D*> magnet_exit_phasespaceX_cutoff;
-    std::vector<TH2D*> magnet_exit_phasespaceY_cutoff;
-    std::vector<std::map<G4int,TH2D*>> magnet_exit_phasespaceX_cutoff_PDG;
-    std::vector<std::map<G4int,TH2D*>> magnet_exit_phasespaceY_cutoff_PDG;
+    std::vector<phaseSpaceAccumulator*> magnet_exit_phasespaceX;
+    std::vector<phaseSpaceAccumulator*> magnet_exit_phasespaceY;
+    std::vector<phaseSpaceAccumulator*> magnet_exit_phasespaceX_cutoff;
+    std::vector<phaseSpaceAccumulator*> magnet_exit_phasespaceY_cutoff;
+    std::vector<std::map<G4int,phaseSpaceAccumulator*>> magnet_exit_phasespaceX_cutoff_PDG;
+    std::vector<std::map<G4int,phaseSpaceAccumulator*>> magnet_exit_phasespaceY_cutoff_PDG;
     std::vector<std::map<G4int,TH1D*>> magnet_exit_energy;
     std::vector<std::map<G4int,TH1D*>> magnet_exit_cutoff_energy;
 
@@ -177,22 +477,22 @@ private:
     std::vector<TH1D*> tracker_energy;
     std::vector<std::map<G4int,TH1D*>> tracker_type_energy;
     std::vector<std::map<G4int,TH1D*>> tracker_type_cutoff_energy;
-    std::vector<TH2D*> tracker_phasespaceX;
-    std::vector<TH2D*> tracker_phasespaceY;
-    std::vector<TH2D*> tracker_phasespaceX_cutoff;
-    std::vector<TH2D*> tracker_phasespaceY_cutoff;
+    std::vector<phaseSpaceAccumulator*> tracker_phasespaceX;
+    std::vector<phaseSpaceAccumulator*> tracker_phasespaceY;
+    std::vector<phaseSpaceAccumulator*> tracker_phasespaceX_cutoff;
+    std::vector<phaseSpaceAccumulator*> tracker_phasespaceY_cutoff;
     std::vector<TH2D*> tracker_phasespaceXY;
     std::vector<TH2D*> tracker_phasespaceXY_cutoff;
-    std::vector<std::map<G4int,TH2D*>> tracker_phasespaceX_cutoff_PDG;
-    std::vector<std::map<G4int,TH2D*>> tracker_phasespaceY_cutoff_PDG;
+    std::vector<std::map<G4int,phaseSpaceAccumulator*>> tracker_phasespaceX_cutoff_PDG;
+    std::vector<std::map<G4int,phaseSpaceAccumulator*>> tracker_phasespaceY_cutoff_PDG;
     std::vector<std::map<G4int,TH2D*>> tracker_phasespaceXY_cutoff_PDG;
 
     std::vector<std::map<G4int,TH1D*>> tracker_Rpos;
     std::vector<std::map<G4int,TH1D*>> tracker_Rpos_cutoff;
 
     //Initial distribution
-    TH2D* init_phasespaceX                                                      = NULL;
-    TH2D* init_phasespaceY                                                      = NULL;
+    phaseSpaceAccumulator* init_phasespaceX                                     = NULL;
+    phaseSpaceAccumulator* init_phasespaceY                                     = NULL;
     TH2D* init_phasespaceXY                                                     = NULL;
     TH1D* init_E                                                                = NULL;
 
@@ -202,12 +502,12 @@ private:
     std::map<G4String,particleTypesCounter> typeCounter;
 
     //Target exit angle RMS
-    G4double target_exitangle;
-    G4double target_exitangle2;
-    G4int target_exitangle_numparticles;
-    G4double target_exitangle_cutoff;
-    G4double target_exitangle2_cutoff;
-    G4int target_exitangle_cutoff_numparticles;
+    CompensatedSum target_exitangle;
+    CompensatedSum target_exitangle2;
+    Long64_t target_exitangle_numparticles;
+    CompensatedSum target_exitangle_cutoff;
+    CompensatedSum target_exitangle2_cutoff;
+    Long64_t target_exitangle_cutoff_numparticles;
 
     // Internal stuff
     //Output file naming
@@ -221,6 +521,7 @@ private:
     G4bool quickmode      = false;
     G4bool anaScatterTest = false;
     G4bool miniFile       = false;
+    G4bool perEventTrees  = false; // One TTree entry per event instead of per hit
 
     G4double beamEnergy; // [MeV]
 
@@ -232,6 +533,9 @@ private:
     static const G4double phasespacehist_posLim;
     static const G4double phasespacehist_angLim;
 
+    // Number of hits per phase space used to choose the histogram ranges (0 => fixed ranges)
+    G4int autoRange = 0;
+
     //Delta z for the energy deposition density radial TH2Ds and TH3Ds [mm, 0 => Disable; < 0 => TH2Ds only]
     G4double edep_dens_dz = 0.0;
 
@@ -241,15 +545,57 @@ private:
     // RNG for sampling over the step
     G4int rngSeed;
     TRandom* RNG                                                                = NULL;
-
-    Int_t eventCounter; // Used for EventID-ing and metadata
-    Int_t numEvents;    // Used for comparing to eventCounter with metadata;
-                        // only reflects the -n <int> command line flag
-                        // so it may be 0 if this was not set.
-
-    void PrintTwissParameters(TH2D* phaseSpaceHist);
+    // Separate RNG for the --treeReservoir sampling, so that it does not change the edep sampling
+    TRandom* reservoirRNG                                                       = NULL;
+
+    Long64_t eventCounter;  // Used for EventID-ing and metadata
+    Long64_t resumedEvents = 0; // Events done before resuming from the checkpoint
+    Long64_t numEvents;     // Used for comparing to eventCounter with metadata;
+                            // only reflects the -n <int> command line flag
+                            // so it may be 0 if this was not set.
+    Long64_t eventIDOffset = 0; // Added to eventCounter for the eventIDs, for sharded runs
+    Long64_t GetEventID() const { return eventIDOffset + eventCounter; };
+
+    phaseSpaceAccumulator* NewPhaseSpace(const char* name, const char* title,
+                                         Int_t nbinsx, Double_t xlow, Double_t xup,
+                                         Int_t nbinsy, Double_t ylow, Double_t yup);
+    void PrintTwissParameters(phaseSpaceAccumulator* phaseSpace);
+    TVectorD GetTwissVector(const MomentAccumulator2D& moments);
+    std::vector<phaseSpaceAccumulator*> GetAllPhaseSpaces();
+    void ConnectPrecisionMonitor();
     void PrintParticleTypes(particleTypesCounter& pt, G4String name);
     void FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type);
+
+    Int_t WriteObject(TObject* obj, const char* name = NULL, Int_t option = 0);
+    void WriteManifest();
+    void CloseRootFile();
+
+    void InitializeStatsOnly();
+    void FinalizeStatsOnly();
+
+    std::vector<TH1*> GetAllHistograms();
+    void WriteCheckpointIfDue();
+    void WriteCheckpoint();
+    G4String GetCheckpointFeatures();
+    void ReadCheckpoint();
+    void ReadCheckpointChunkIndex();
+    void WriteLiveSnapshotIfDue();
+    void WriteProgressIfDue();
+    void WriteProgress(const char* status);
+
+    void SetupEventTrigger();
+    void CreateHitTrees();
+    void OpenChunkFile();
+    void CloseChunkFile();
+    // Size of the current chunk file if it was closed now [bytes]; includes the
+    // filled baskets that are not yet written, uncompressed, so it is an upper bound
+    Long64_t GetChunkFileSize();
+    void CreateHitTree(TTree*& tree, const char* name, const char* title,
+                       trackerHitStruct& buffer, trackerHitEventStruct& eventBuffer);
+    void FillHitTrees();
+    void ClearHitStaging();
+    G4bool FilterHit(G4int planeIdx, const trackerHitStruct& hit);
+    void WriteHitTreeStats();
 };
 
 #endif
@@ -0,0 +1,63 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef RUNCOUNTERS_HH
+#define RUNCOUNTERS_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <map>
+#include <vector>
+
+// Counters of what an optional feature did during the run, e.g. the number of tracks
+// and the kinetic energy stopped by the range rejection.
+// A feature registers its counters when it is set up, and adds to them while running.
+// RootFileWriter then handles all the registered counters the same way: it resets them
+// at the start of the run, writes each set as the TVectorD '<name>' in the output file,
+// and stores and restores them in the checkpoints.
+// The application is single-threaded, so the counters are plain numbers.
+class RunCounters {
+public:
+    // The counters with this name, created on the first call; labels gives the name [unit] of each counter
+    static RunCounters* Register(const G4String& name, const std::vector<G4String>& labels);
+    // All the registered counters, by name
+    static std::map<G4String,RunCounters>& GetAll() { return registry; };
+
+    void Add(size_t idx, G4double value) { values[idx] += value; };
+    void Reset();
+
+    const G4String& GetName() const { return name; };
+    const std::vector<G4String>& GetLabels() const { return labels; };
+    const std::vector<G4double>& GetValues() const { return values; };
+    // Restore the values, when resuming from a checkpoint
+    void SetValues(const std::vector<G4double>& values_in);
+
+    void Print() const;
+
+private:
+    RunCounters(const G4String& name_in, const std::vector<G4String>& labels_in) :
+        name(name_in), labels(labels_in), values(labels_in.size(), 0.0) {};
+
+    G4String name;
+    std::vector<G4String> labels;
+    std::vector<G4double> values;
+
+    static std::map<G4String,RunCounters> registry;
+};
+
+#endif
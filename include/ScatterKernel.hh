@@ -0,0 +1,105 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SCATTERKERNEL_HH
+#define SCATTERKERNEL_HH 1
+
+#include "G4String.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include "TrackerHit.hh"
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TFile;
+class TTree;
+
+// One particle leaving the target, relative to the primary at the target entrance (z = -thickness/2):
+// Transverse position offset and direction in the frame where the primary goes along z, and the exit z.
+// The exit z is stored as the nearest face (+1 downstream, -1 upstream) and the offset from it,
+// so that the position is rebuilt exactly from the thickness, also for thick targets;
+// the offset along the primary axis follows from it.
+struct kernelParticle {
+    Float_t dx, dy;    // [mm]
+    Int_t   face;
+    Float_t dz;        // z - face*thickness/2 [mm]
+    Float_t ux, uy, uz;
+    Float_t E;         // Kinetic energy [MeV]
+    Int_t   PDG;
+};
+
+// Scattering kernel of the target: The particles leaving the target for each primary,
+// recorded from a full simulation (--writeKernel) and sampled instead of tracking
+// the primary through the target (--readKernel).
+// The kernel is valid for the target material, thickness and beam particle and energy
+// it was made with, without target rotation. When sampling, each recorded event is rotated
+// by a random angle around the beam axis, and then to the direction of the new primary.
+class ScatterKernel {
+public:
+    ScatterKernel() {};
+    ~ScatterKernel();
+
+    // Writing
+    void OpenForWriting(G4String fileName_in, G4String material_in, G4double thickness_in,
+                        G4double energy_in, G4String particle_in);
+    // Add the target exit hits of one event. The primary is at (x,y,z0) with slopes (xp,yp) [G4 units]
+    void AddEvent(TrackerHitsCollection* exitHits,
+                  G4double x, G4double xp, G4double y, G4double yp, G4double z0);
+    void CloseForWriting();
+
+    // Reading
+    void Load(G4String fileName_in);
+    // Exits with an error if the kernel was made for a different setup
+    void CheckCompatible(G4String material_in, G4double thickness_in, G4double angle_in,
+                         G4double energy_in, G4String particle_in, G4bool flatEnergy);
+    // The particles leaving the target for a primary at (x,y,z0) with slopes (xp,yp) [G4 units]
+    // Positions [G4 units] are just inside the target, so that they are scored as exiting by TargetSD.
+    struct sampledParticle {
+        G4int PDG;
+        G4ThreeVector position;
+        G4ThreeVector direction;
+        G4double E; // [G4 units]
+    };
+    const std::vector<sampledParticle>& Sample(G4double x, G4double xp, G4double y, G4double yp, G4double z0);
+
+    G4long GetNumEvents() const { return numEvents; };
+
+private:
+    G4String fileName;
+    G4String material;
+    G4double thickness = 0.0; // [mm]
+    G4double energy    = 0.0; // [MeV]
+    G4String particle;
+    G4long   numEvents = 0;
+    // Increased when the meaning of the stored variables changes
+    static const G4int formatVersion = 2;
+
+    // The kernel TTree has one entry per primary, with one element per particle leaving the target
+    TFile* kernelFile = NULL;
+    TTree* kernelTree = NULL;
+    std::vector<Float_t> tree_dx, tree_dy, tree_dz, tree_ux, tree_uy, tree_uz, tree_E;
+    std::vector<Int_t>   tree_face, tree_PDG;
+
+    std::vector<kernelParticle> particles; // All the particles, event by event
+    std::vector<size_t> eventStart;        // Index of the first particle of each event, and the end
+    std::vector<sampledParticle> sampled;
+};
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SPLITSTRING_HH
+#define SPLITSTRING_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <vector>
+
+// Split a command line argument at each occurrence of the single-character separator sep,
+// e.g. SplitString("a,b,,c", ",") => {"a", "b", "", "c"}. A string without sep gives one element.
+inline std::vector<G4String> SplitString(G4String listString, const char* sep) {
+    std::vector<G4String> list;
+    str_size startPos = 0;
+    str_size endPos = 0;
+    do {
+        endPos = listString.index(sep,startPos);
+        list.push_back(listString(startPos,endPos-startPos));
+        startPos = endPos+1;
+    } while (endPos != std::string::npos);
+    return list;
+}
+
+#endif
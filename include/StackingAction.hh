@@ -0,0 +1,77 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <cfloat>
+#include <set>
+#include <vector>
+
+class G4VPhysicalVolume;
+class RunCounters;
+
+// One rule of the stacking policy; a secondary matching all the given conditions
+// is killed before it is tracked, or postponed to after all the other tracks in the event.
+struct stackingRule {
+    G4String definition;
+    G4bool   postpone = false;
+
+    std::set<G4int> PDGs;          // Empty => all particle types
+    G4double Emin = 0.0;           // Kinetic energy [MeV]
+    G4double Emax = DBL_MAX;       // Kinetic energy [MeV]
+    std::vector<G4String> volumes; // Where the track was created; empty => anywhere
+    std::set<const G4VPhysicalVolume*> volumePVs; // The matching physical volumes
+    G4int    direction = 0;        // +1 => pz > 0, -1 => pz < 0, 0 => any
+};
+
+// Stacking policy for secondaries (--stacking), keeping tracks that can never
+// reach a detector from being tracked. Primaries are never affected.
+// Defined from a string of rules separated by ';', each rule being key=val pairs
+// separated by ':' (lists separated by ','), e.g.
+//   PDG=22,11:Emax=0.1;volume=target:dir=backward
+// Keys: action (kill or postpone, default kill), PDG, Emin, Emax [MeV],
+// volume (target, a magnet name, or a physical volume name), dir (forward or backward).
+// The first matching rule is applied. A rule without conditions ('action=kill') matches
+// all secondaries, so that only the primaries are tracked.
+// The matching tracks and their kinetic energy are counted per rule in the RunCounters 'stacking'.
+class StackingAction : public G4UserStackingAction {
+public:
+    StackingAction(G4String stackingString);
+    virtual ~StackingAction(){};
+
+    virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* track);
+
+    const G4String& GetDefinition() const { return definition; };
+    const std::vector<stackingRule>& GetRules() const { return rules; };
+
+private:
+    stackingRule ParseRule(G4String ruleString);
+    // Find the physical volumes for the 'volume' conditions, once the geometry is built
+    void ResolveVolumes();
+
+    G4String definition;
+    std::vector<stackingRule> rules;
+    RunCounters* counters = NULL; // [number of tracks, kinetic energy [MeV]] per rule
+    G4bool volumesResolved = false;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef SteppingAction_h
+#define SteppingAction_h 1
+
+#include "G4UserSteppingAction.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+class G4Navigator;
+class G4VPhysicalVolume;
+class G4Track;
+class DetectorConstruction;
+class VirtualTrackerWorldConstruction;
+class PlaneScorer;
+class RunCounters;
+
+// Analytic drift to the tracker planes (--analyticDrift): a track in the world volume,
+// which is vacuum, is checked for having a straight path to the edge of the world
+// that crosses no object and no magnetic field. It is then moved analytically;
+// a hit is recorded in each tracker plane the line enters inside the world, exactly
+// as TrackerSD would, and the track is killed. Only stable particles are drifted,
+// since others could decay on the way.
+// Also feeds every step to the PlaneScorer (--scorePlanes), if given;
+// a drifted track is scored along its straight path to the edge of the world.
+// The drifted tracks are counted in the RunCounters 'analyticDrift'.
+class SteppingAction : public G4UserSteppingAction {
+public:
+    SteppingAction(DetectorConstruction* detCon_in, VirtualTrackerWorldConstruction* trackers_in,
+                   G4bool analyticDrift_in, PlaneScorer* planeScorer_in);
+    virtual ~SteppingAction();
+
+    virtual void UserSteppingAction(const G4Step* step);
+
+private:
+    // True if the straight line from pos along dir leaves the world without entering another volume
+    G4bool IsFreePath(const G4ThreeVector& pos, const G4ThreeVector& dir);
+    // Distance along dir from pos (inside the world) to the edge of the world
+    G4double DistanceToWorldEdge(const G4ThreeVector& pos, const G4ThreeVector& dir) const;
+    // Record the hits of the planes ahead of the track
+    void DriftToTrackers(const G4Track* track);
+
+    DetectorConstruction*            detCon   = NULL;
+    VirtualTrackerWorldConstruction* trackers = NULL;
+    G4bool analyticDrift = false;
+    PlaneScorer* planeScorer = NULL; // Not owned
+
+    G4Navigator* navigator = NULL; // Own navigator in the mass world, not to disturb the tracking
+    const G4VPhysicalVolume* worldPV = NULL;
+    G4bool fieldChecked = false;
+    G4bool worldHasField = false;
+
+    RunCounters* counters = NULL; // Only if analyticDrift
+};
+
+#endif
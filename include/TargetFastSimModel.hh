@@ -0,0 +1,84 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TargetFastSimModel_h
+#define TargetFastSimModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "globals.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <vector>
+#include <utility>
+
+class G4Material;
+class RunCounters;
+
+// Fast simulation of the passage of charged particles through a thin target (--targetFastSim).
+// A particle entering the upstream face of the target is moved to the downstream face in one step:
+//  - The exit angle and the correlated lateral displacement are sampled from the screened
+//    Rutherford scatterings of Moliere theory, split at 2.5 times the Highland theta0:
+//    A Gaussian core with the variance of the scatterings below the split, plus a single
+//    scattering tail, i.e. a Poisson number of individual scatterings above it.
+//    The core is thus narrower than theta0, and the total variance is not double counted.
+//  - The collision energy loss is sampled from the Landau distribution (PDG most probable
+//    loss with the density effect correction), and deposited in the target.
+//  - For e+/e-, the energy lost to bremsstrahlung is sampled from the Bethe-Heitler
+//    thin target distribution, and emitted as a single photon along the exit direction.
+// No delta rays or backscattering are produced. Tracks losing more than maxLossFraction
+// of their kinetic energy, or entering too close to the edge, are tracked normally.
+// The final step is just inside the downstream face, so that the exit is scored by TargetSD.
+// The scattering split and the bremsstrahlung loss distribution are not yet validated against
+// full tracking; scripts/validateTargetFastSim.py makes the comparison.
+// The tracks moved by the model are counted in the RunCounters 'targetFastSim'.
+class TargetFastSimModel : public G4VFastSimulationModel {
+public:
+    TargetFastSimModel(G4String modelName, G4Region* envelope, G4double targetThickness_arg);
+    virtual ~TargetFastSimModel(){};
+
+    virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+    virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+    virtual void   DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+private:
+    G4double targetThickness; // [G4 units]
+    const G4double maxLossFraction = 0.05;
+    const G4double tailCut         = 2.5;    // Tail scatterings are above tailCut*theta0
+    // Entering tracks are on the upstream face within this distance,
+    // and the final position is this far inside the downstream face
+    const G4double faceTolerance   = 1.0*nm;
+
+    // Material constants, computed for the first material seen
+    void SetupMaterial(const G4Material* material);
+    const G4Material* currentMaterial = NULL;
+    G4double radLength        = 0.0; // [G4 units]
+    G4double chic2Factor      = 0.0; // chi_c^2 = chic2Factor * z^2 * x / (p*beta)^2
+    std::vector<std::pair<G4double,G4double>> screeningElements; // (weight, Z) for the screening angle
+    G4double xiFactor         = 0.0; // xi = xiFactor * z^2 * x / beta^2
+    G4double meanExcitation   = 0.0; // [G4 units]
+
+    // Moliere screening angle chi_a^2 [rad^2]
+    G4double ScreeningAngle2(G4double p, G4double beta, G4double charge);
+    // Most probable collision loss and Landau width xi for a path length x [G4 units]
+    void LandauParameters(const G4Track* track, G4double x, G4double& mpLoss, G4double& xi);
+    // Mean fraction of the energy lost to bremsstrahlung by e+/e- in the Bethe-Heitler model
+    G4double BremsLossFraction(G4double x) { return 1.0 - pow(2.0, -x/radLength*4.0/3.0); };
+
+    RunCounters* counters = NULL;
+};
+
+#endif
@@ -24,6 +24,7 @@
 
 class G4HCofThisEvent;
 class G4TouchableHistory;
+class G4ParticleDefinition;
 class G4Step;
 
 class TrackerSD : public G4VSensitiveDetector {
@@ -38,6 +39,10 @@ public:
 
     virtual G4bool ProcessHits(G4Step* aStep,G4TouchableHistory* history);
 
+    // Record a particle entering the tracker plane; also used by the analytic drift (SteppingAction)
+    void AddHit(const G4ThreeVector& hitPos, const G4ThreeVector& momentum, G4double energy,
+                const G4ParticleDefinition* particleType);
+
     virtual void EndOfEvent(G4HCofThisEvent*) {};
 private:
 
@@ -0,0 +1,69 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TREEHITFILTER_HH
+#define TREEHITFILTER_HH 1
+
+#include "G4String.hh"
+#include "globals.hh"
+
+#include <cfloat>
+#include <set>
+#include <vector>
+
+// Write-time selection of the hits that are stored in the TTrees.
+// Defined from a string of key=val pairs separated by ':', e.g.
+//   planes=target,2:PDG=11,-11:Emin=100:Rmax=5
+// where lists are separated by ','.
+class TreeHitFilter {
+public:
+    TreeHitFilter() {};
+
+    void Parse(G4String filterString);
+    void Print() const;
+
+    G4bool IsActive() const { return active; };
+    const G4String& GetDefinition() const { return definition; };
+
+    // Plane index 0 is the target exit, 1..N are the trackers
+    G4bool AcceptPlane(G4int planeIdx) const {
+        if (planes.empty()) return true;
+        return planes.count(planeIdx) > 0;
+    };
+    // Energy [MeV] and radius [mm]
+    G4bool Accept(G4int planeIdx, G4int PDG, G4double E, G4double R) const {
+        if (not active) return true;
+        if (not AcceptPlane(planeIdx)) return false;
+        if (not PDGs.empty() and PDGs.count(PDG) == 0) return false;
+        if (E < Emin or E > Emax) return false;
+        if (R < Rmin or R > Rmax) return false;
+        return true;
+    };
+
+private:
+    G4String definition = "";
+    G4bool   active     = false;
+
+    std::set<G4int> planes; // Empty => all planes
+    std::set<G4int> PDGs;   // Empty => all particle types
+    G4double Emin = 0.0;    // [MeV]
+    G4double Emax = DBL_MAX;// [MeV]
+    G4double Rmin = 0.0;    // [mm]
+    G4double Rmax = DBL_MAX;// [mm]
+};
+
+#endif
@@ -25,6 +25,8 @@
 
 #include "DetectorConstruction.hh"
 
+class TrackerSD;
+
 // Parallel geometry in which the tracker planes and their sensitive detectors are defined;
 // this makes it possible to place the planes completely freely.
 
@@ -41,6 +43,13 @@ public:
     inline G4double getTrackerSizeX()    const {return TrackerSizeX;};
     inline G4double getTrackerSizeY()    const {return TrackerSizeY;};
 
+    // Plane geometry, all in G4 units; the downstream face of each plane passes through (0,0,distance),
+    // and its normal is the z axis rotated by the angle around the y axis.
+    inline const std::vector<G4double>& getTrackerDistances() const {return trackerDistances;};
+    inline G4double getTrackerAngle()     const {return trackerAngle;};
+    inline G4double getTrackerThickness() const {return TrackerThickness;};
+    inline TrackerSD* getTrackerSD(size_t idx) const {return trackerSDs.at(idx);};
+
     //Used to compute the length of the volume; all input in mm and deg
     static G4double ComputeMaxAbsZ(std::vector<G4double>* trackerDistances_in, G4double trackerAngle_in, G4double world_size) {
         if (trackerDistances_in->size() == 0) return 0.0; //If no trackers
@@ -84,6 +93,7 @@ private:
     
     std::vector <G4LogicalVolume*>   virtualTrackerLVs;
     std::vector <G4VPhysicalVolume*> virtualTrackerPVs;
+    std::vector <TrackerSD*>         trackerSDs;
 
 public:
     int getNumTrackers() {return virtualTrackerLVs.size();};
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+
+## Script to benchmark the EM presets (--emPreset) on two canonical geometries,
+## comparing the run time to the key observables of each geometry:
+##  - Thin foil:      200 MeV e- through 1 mm Al; emittance after the target and e- in the tracker.
+##  - Thick shield:   200 MeV e- into 50 mm W;    mean energy deposit and particles leaking out.
+## Run from the folder containing the MiniScatter executable, optionally giving the number of events.
+## Note that the first run also includes the one-time startup of the physics tables.
+## The results are printed as a markdown table, as in the 'EM physics presets' section of CommandLineUse.md.
+
+import sys
+import os
+import time
+import subprocess
+
+import miniScatterDriver
+
+N = 10000
+if len(sys.argv) == 2:
+    N = int(sys.argv[1])
+
+presets = ["precise-thin-foil", "balanced", "fast-shielding"]
+
+baseSimSetup = {}
+baseSimSetup["PHYS"]      = "QGSP_FTFP_BERT"
+baseSimSetup["BEAM"]      = "e-"
+baseSimSetup["ENERGY"]    = 200.0 #[MeV]
+baseSimSetup["N"]         = N
+baseSimSetup["DIST"]      = 100.0 #Detector distance from target center [mm]
+baseSimSetup["QUICKMODE"] = True  #Skip verification plots
+baseSimSetup["MINIROOT"]  = True  #Skip TTRees in the .root files
+baseSimSetup["OUTFOLDER"] = os.path.join(os.getcwd(), "benchmarkEmPresets")
+
+geometries = {}
+geometries["thinFoil"]    = {"THICK": 1.0,  "MAT": "G4_Al"}
+geometries["thickShield"] = {"THICK": 50.0, "MAT": "G4_W"}
+
+results = {}
+for geoName, geo in geometries.items():
+    for preset in presets:
+        simSetup = baseSimSetup.copy()
+        simSetup.update(geo)
+        simSetup["PHYS_EM_PRESET"] = preset
+        simSetup["OUTNAME"]        = "benchmark_" + geoName + "_" + preset
+
+        print("Running", geoName, "with the EM preset", preset, flush=True)
+        startTime = time.time()
+        miniScatterDriver.runScatter(simSetup, quiet=True)
+        runTime = time.time() - startTime
+
+        (twiss, numPart, objects) = miniScatterDriver.getData(
+            os.path.join(simSetup["OUTFOLDER"], simSetup["OUTNAME"]+".root"), quiet=True, getObjects=["targetEdep"])
+
+        results[(geoName, preset)] = {
+            "time"     : runTime,
+            "eps_x"    : twiss["target_exit"]["x"]["eps"],
+            "edep"     : objects["targetEdep"].GetMean(),
+            "tracker_e": numPart["tracker"].get(11, 0) / N,
+            "tracker_g": numPart["tracker"].get(22, 0) / N,
+        }
+
+try:
+    g4version = subprocess.run(["geant4-config", "--version"], capture_output=True, text=True).stdout.strip()
+except OSError:
+    g4version = "unknown (geant4-config not found)"
+
+print()
+print("Geant4 {}, N = {} events per run".format(g4version, N))
+print()
+print("| {:12s} | {:18s} | {:>10s} | {:>10s} | {:>14s} | {:>12s} | {:>12s} | {:>12s} |".format(
+    "Geometry", "Preset", "Time [s]", "Speedup", "eps_x [um]", "Edep [MeV]", "e-/event", "gamma/event"))
+print("|" + "|".join(["-"*14, "-"*20] + ["-"*12]*2 + ["-"*16] + ["-"*14]*3) + "|")
+for geoName in geometries:
+    refTime = results[(geoName, "balanced")]["time"]
+    for preset in presets:
+        r = results[(geoName, preset)]
+        print("| {:12s} | {:18s} | {:10.1f} | {:10.2f} | {:14.5g} | {:12.5g} | {:12.4f} | {:12.4f} |".format(
+            geoName, preset, r["time"], refTime/r["time"], r["eps_x"], r["edep"], r["tracker_e"], r["tracker_g"]))
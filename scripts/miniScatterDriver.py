@@ -22,19 +22,42 @@ import os
 import ROOT
 import ROOT.TFile, ROOT.TVector
 import datetime
+import json
+import threading
 
-def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=False):
-    "Run a MiniScatter simulation, given the parameters that are described by running './MiniScatter -h'. as the map simSetup."
+def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=False, liveCallback=None, progressCallback=None):
+    """
+    Run a MiniScatter simulation, given the parameters that are described by running './MiniScatter -h'. as the map simSetup.
+
+    If liveCallback is given (requires LIVE_SNAPSHOT in simSetup), it is called as
+    liveCallback(progress, twiss, numPart) whenever MiniScatter writes a new live snapshot,
+    where progress = {'events', 'numEvents', 'time'} and twiss, numPart are as from getData().
+    If it returns True, the simulation is stopped (SIGTERM) after the current event,
+    and the output file is written with the events simulated so far.
+
+    If progressCallback is given, it is called with a dict for every progress report from MiniScatter
+    (at most every PROGRESS_INTERVAL seconds, default 1), with the keys
+    'status' ('running', 'finalizing' or 'done'), 'events', 'numEvents', 'elapsed' [s], 'rate' [events/s],
+    'eta' [s] (-1 if unknown), 'rss_MB', 'bufferedHits', 'hits' (number of particles per detector)
+    and 'hitRates' (particles per detector per second since the last report).
+    It is called from a separate thread.
+    """
 
     if quiet and allOutput:
         raise AssertionError("Setting both 'quiet' and 'alloutput' makes no sense")
 
     for key in simSetup.keys():
         if not key in ("THICK", "MAT", "PRESS", "DIST", "ANG", "TARG_ANG", "WORLDSIZE", "PHYS", "PHYS_CUTDIST",\
+                       "PHYS_CUTDIST_TARGET", "PHYS_CUTDIST_OBJECT", "PHYS_RANGE_REJECTION",\
+                       "PHYS_EM_PRESET", "PHYS_EM_PRESET_TARGET", "PHYS_EM_PRESET_OBJECT", "TARGET_FASTSIM",\
                        "N", "ENERGY", "ENERGY_FLAT",\
                        "BEAM", "XOFFSET", "ZOFFSET", "ZOFFSET_BACKTRACK",\
                        "COVAR", "BEAM_RCUT", "SEED", \
-                       "OUTNAME", "OUTFOLDER", "QUICKMODE", "MINIROOT",\
+                       "OUTNAME", "OUTFOLDER", "QUICKMODE", "MINIROOT", "PER_EVENT_TREES",\
+                       "TREE_FILTER", "TREE_RESERVOIR", "TRIGGER", "CHUNK_EVENTS", "CHUNK_SIZE", "STATS_ONLY",\
+                       "PRECISION", "PRECISION_BATCH", "CHECKPOINT_EVENTS", "CHECKPOINT_TIME", "RESUME",\
+                       "LIVE_SNAPSHOT", "MAX_WALLTIME", "PROGRESS_INTERVAL", "RECORD_RNG", "REPLAY", "EVENTID_OFFSET",\
+                       "AUTO_RANGE", "STACKING", "WRITE_KERNEL", "READ_KERNEL", "ANALYTIC_DRIFT", "SCORE_PLANES",\
                        "CUTOFF_ENERGYFRACTION", "CUTOFF_RADIUS", "EDEP_DZ", "ENG_NBINS"):
             if key.startswith("MAGNET"):
                 continue
@@ -81,6 +104,30 @@ def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=
     if "PHYS_CUTDIST" in simSetup:
         cmd += ["--physCutoffDist", str(simSetup["PHYS_CUTDIST"])]
 
+    if "PHYS_CUTDIST_TARGET" in simSetup:
+        cmd += ["--targetCut", str(simSetup["PHYS_CUTDIST_TARGET"])]
+
+    if "PHYS_CUTDIST_OBJECT" in simSetup:
+        cmd += ["--objectCut", str(simSetup["PHYS_CUTDIST_OBJECT"])]
+
+    if "PHYS_RANGE_REJECTION" in simSetup:
+        cmd += ["--rangeRejection", str(simSetup["PHYS_RANGE_REJECTION"])]
+
+    if "PHYS_EM_PRESET" in simSetup:
+        cmd += ["--emPreset", str(simSetup["PHYS_EM_PRESET"])]
+
+    if "PHYS_EM_PRESET_TARGET" in simSetup:
+        cmd += ["--emPresetTarget", str(simSetup["PHYS_EM_PRESET_TARGET"])]
+
+    if "PHYS_EM_PRESET_OBJECT" in simSetup:
+        cmd += ["--emPresetObject", str(simSetup["PHYS_EM_PRESET_OBJECT"])]
+
+    if "TARGET_FASTSIM" in simSetup:
+        if simSetup["TARGET_FASTSIM"] == True:
+            cmd += ["--targetFastSim"]
+        else:
+            assert simSetup["TARGET_FASTSIM"] == False
+
     if "N" in simSetup:
         cmd += ["-n", str(simSetup["N"])]
 
@@ -142,6 +189,97 @@ def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=
         else:
             assert simSetup["MINIROOT"] == False
 
+    if "PER_EVENT_TREES" in simSetup:
+        if simSetup["PER_EVENT_TREES"] == True:
+            cmd += ["--perEventTrees"]
+        else:
+            assert simSetup["PER_EVENT_TREES"] == False
+
+    if "TREE_FILTER" in simSetup:
+        cmd += ["--treeFilter", str(simSetup["TREE_FILTER"])]
+
+    if "TREE_RESERVOIR" in simSetup:
+        cmd += ["--treeReservoir", str(simSetup["TREE_RESERVOIR"])]
+
+    if "TRIGGER" in simSetup:
+        cmd += ["--trigger", str(simSetup["TRIGGER"])]
+
+    if "CHUNK_EVENTS" in simSetup:
+        cmd += ["--chunkEvents", str(simSetup["CHUNK_EVENTS"])]
+
+    if "CHUNK_SIZE" in simSetup:
+        cmd += ["--chunkSize", str(simSetup["CHUNK_SIZE"])]
+
+    if "STATS_ONLY" in simSetup:
+        if simSetup["STATS_ONLY"] == True:
+            cmd += ["--statsOnly"]
+        else:
+            assert simSetup["STATS_ONLY"] == False
+
+    if "PRECISION" in simSetup:
+        cmd += ["--precision", str(simSetup["PRECISION"])]
+
+    if "PRECISION_BATCH" in simSetup:
+        cmd += ["--precisionBatch", str(simSetup["PRECISION_BATCH"])]
+
+    if "CHECKPOINT_EVENTS" in simSetup:
+        cmd += ["--checkpointEvents", str(simSetup["CHECKPOINT_EVENTS"])]
+
+    if "CHECKPOINT_TIME" in simSetup:
+        cmd += ["--checkpointTime", str(simSetup["CHECKPOINT_TIME"])]
+
+    if "RESUME" in simSetup:
+        if simSetup["RESUME"] == True:
+            cmd += ["--resume"]
+        else:
+            assert simSetup["RESUME"] == False
+
+    if "LIVE_SNAPSHOT" in simSetup:
+        cmd += ["--liveSnapshot", str(simSetup["LIVE_SNAPSHOT"])]
+
+    if "MAX_WALLTIME" in simSetup:
+        cmd += ["--maxWallTime", str(simSetup["MAX_WALLTIME"])]
+
+    if "PROGRESS_INTERVAL" in simSetup:
+        cmd += ["--progressInterval", str(simSetup["PROGRESS_INTERVAL"])]
+
+    if "RECORD_RNG" in simSetup:
+        cmd += ["--recordRNG", str(simSetup["RECORD_RNG"])]
+
+    if "REPLAY" in simSetup:
+        cmd += ["--replay", str(simSetup["REPLAY"])]
+
+    if "EVENTID_OFFSET" in simSetup:
+        cmd += ["--eventIDOffset", str(simSetup["EVENTID_OFFSET"])]
+
+    if "AUTO_RANGE" in simSetup:
+        cmd += ["--autoRange", str(simSetup["AUTO_RANGE"])]
+
+    if "STACKING" in simSetup:
+        cmd += ["--stacking", str(simSetup["STACKING"])]
+
+    if "WRITE_KERNEL" in simSetup:
+        cmd += ["--writeKernel", str(simSetup["WRITE_KERNEL"])]
+
+    if "READ_KERNEL" in simSetup:
+        cmd += ["--readKernel", str(simSetup["READ_KERNEL"])]
+
+    if "ANALYTIC_DRIFT" in simSetup:
+        if simSetup["ANALYTIC_DRIFT"] == True:
+            cmd += ["--analyticDrift"]
+        else:
+            assert simSetup["ANALYTIC_DRIFT"] == False
+
+    if "SCORE_PLANES" in simSetup:
+        cmd += ["--scorePlanes", str(simSetup["SCORE_PLANES"])]
+
+    # The progress reports are sent through a pipe, which is inherited by MiniScatter
+    progressRead = None
+    progressWrite = None
+    if progressCallback is not None:
+        (progressRead, progressWrite) = os.pipe()
+        cmd += ["--progressFD", str(progressWrite)]
+
     if "CUTOFF_ENERGYFRACTION" in simSetup:
         cmd += ["--cutoffEnergyFraction", str(simSetup["CUTOFF_ENERGYFRACTION"])]
 
@@ -190,11 +328,46 @@ def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=
     # #print (runResults)
 
     #Inspired by https://stackoverflow.com/questions/52545512/realtime-output-from-a-shell-command-in-jupyter-notebook
-    process = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, bufsize=1, close_fds=True, cwd=runFolder, universal_newlines=True)
+    liveName = None
+    liveMtime = None
+    liveAborted = False
+    if liveCallback is not None:
+        if not "LIVE_SNAPSHOT" in simSetup:
+            raise KeyError("liveCallback requires LIVE_SNAPSHOT in the simSetup")
+        liveName = os.path.join(runFolder, simSetup.get("OUTFOLDER","plots"), simSetup.get("OUTNAME","output")+"_live.root")
+        if os.path.exists(liveName):
+            os.remove(liveName) # Left over from an earlier run
+
+    passFds = ()
+    if progressWrite is not None:
+        passFds = (progressWrite,)
+    process = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, bufsize=1, close_fds=True, cwd=runFolder, universal_newlines=True, pass_fds=passFds)
+
+    progressThread = None
+    if progressWrite is not None:
+        os.close(progressWrite) # Only the child writes; EOF when it exits
+        def progressReader():
+            with os.fdopen(progressRead, 'r') as progressFile:
+                for progressLine in progressFile:
+                    progressCallback(json.loads(progressLine))
+        progressThread = threading.Thread(target=progressReader, daemon=True)
+        progressThread.start()
     linebuff = ""
     spinnerState = None # 0=/, 1=-, 2=\, 3=| (cycle); None: Last printout was an event, so issue a newline not a carriage return
 
     for line in iter(process.stdout.readline, ''):
+        # The snapshot is replaced atomically by MiniScatter, so it is always complete
+        if liveName is not None and not liveAborted and os.path.exists(liveName):
+            mtime = os.stat(liveName).st_mtime
+            if mtime != liveMtime:
+                liveMtime = mtime
+                (twiss, numPart, objects) = getData(liveName, quiet=True, getObjects=["live_progress"])
+                liveProgress = objects["live_progress"]
+                progress = {'events':int(liveProgress[0]), 'numEvents':int(liveProgress[1]), 'time':liveProgress[2]}
+                if liveCallback(progress, twiss, numPart) == True:
+                    process.terminate()
+                    liveAborted = True
+
         if allOutput:
             print(line.rstrip())
             logFile.write(line.rstrip()+"\n")
@@ -234,12 +407,16 @@ def runScatter(simSetup, quiet=False,allOutput=False, logName=None, onlyCommand=
                 linebuff = ls[1]
     process.stdout.close()
     returncode = process.wait()
+    if progressThread is not None:
+        progressThread.join()
     logFile.close()
 
     if not quiet:
         print('',end='\n')
         print ("Done!")
     
+    if liveAborted and not quiet:
+        print("Simulation stopped by liveCallback")
     if returncode != 0:
         print("Errors encountered during simulation")
         print("Please check logfile '"+logName+"'")
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+## Script to validate the target fast simulation (--targetFastSim) against full tracking,
+## for 200 MeV e- through a few thin foils. For each foil and mode it compares:
+##  - The RMS exit angle of the charged particles passing the cutoff (from target_exit_cutoff, x plane).
+##  - The fraction of the particles exiting at more than 3*theta0 (the single scattering tail).
+##  - The mean energy deposit in the target, and the mean energy of the exiting e-.
+## Run from the folder containing the MiniScatter executable, optionally giving the number of events.
+## Note that the first run also includes the one-time startup of the physics tables.
+## The results are printed as a markdown table, headed by the Geant4 version and the number of events,
+## including the thickness in radiation lengths, to find the range where the fast simulation agrees.
+
+import sys
+import os
+import time
+import math
+import subprocess
+
+import miniScatterDriver
+
+N = 100000
+if len(sys.argv) == 2:
+    N = int(sys.argv[1])
+
+baseSimSetup = {}
+baseSimSetup["PHYS"]      = "QGSP_FTFP_BERT"
+baseSimSetup["BEAM"]      = "e-"
+baseSimSetup["ENERGY"]    = 200.0 #[MeV]
+baseSimSetup["N"]         = N
+baseSimSetup["DIST"]      = 100.0 #Detector distance from target center [mm]
+baseSimSetup["QUICKMODE"] = True  #Skip verification plots
+baseSimSetup["MINIROOT"]  = True  #Skip TTRees in the .root files
+baseSimSetup["OUTFOLDER"] = os.path.join(os.getcwd(), "validateTargetFastSim")
+
+# Foils: (material, thickness [mm], radiation length [mm])
+foils = {}
+foils["Be_0.5mm"]  = ("G4_Be", 0.5,  352.8)
+foils["Al_1mm"]    = ("G4_Al", 1.0,   88.97)
+foils["Cu_0.1mm"]  = ("G4_Cu", 0.1,   14.36)
+foils["W_0.05mm"]  = ("G4_W",  0.05,   3.504)
+
+def highlandTheta0(thickness, radLength, E):
+    "Highland theta0 [rad] for an e- with kinetic energy E [MeV]"
+    m = 0.51099895
+    p = math.sqrt((E+m)**2 - m**2)
+    beta = p/(E+m)
+    t = thickness/radLength
+    return 13.6/(beta*p) * math.sqrt(t) * (1 + 0.038*math.log(t/beta**2))
+
+results = {}
+for foilName, (mat, thick, radLength) in foils.items():
+    theta0 = highlandTheta0(thick, radLength, baseSimSetup["ENERGY"])
+    for fastSim in (False, True):
+        mode = "fastSim" if fastSim else "tracking"
+        simSetup = baseSimSetup.copy()
+        simSetup["MAT"]            = mat
+        simSetup["THICK"]          = thick
+        simSetup["TARGET_FASTSIM"] = fastSim
+        simSetup["OUTNAME"]        = "validate_" + foilName + "_" + mode
+
+        print("Running", foilName, "with", mode, flush=True)
+        startTime = time.time()
+        miniScatterDriver.runScatter(simSetup, quiet=True)
+        runTime = time.time() - startTime
+
+        (twiss, numPart, objects) = miniScatterDriver.getData(
+            os.path.join(simSetup["OUTFOLDER"], simSetup["OUTNAME"]+".root"), quiet=True,
+            getObjects=["targetEdep", "target_exit_angle_cutoff", "target_exit_energy_PDG11"])
+
+        # Exit angle histogram is in degrees
+        angleHist = objects["target_exit_angle_cutoff"]
+        tailCut   = 3*theta0*180/math.pi
+        numTotal  = angleHist.Integral()
+        numTail   = numTotal - angleHist.Integral(angleHist.FindBin(-tailCut), angleHist.FindBin(tailCut))
+
+        results[(foilName, mode)] = {
+            "time"     : runTime,
+            "theta0"   : theta0,
+            "theta_rms": math.sqrt(twiss["target_exit_cutoff"]["x"]["angVar"]),
+            "tail"     : numTail/numTotal if numTotal > 0 else float('nan'),
+            "edep"     : objects["targetEdep"].GetMean(),
+            "E_exit"   : objects["target_exit_energy_PDG11"].GetMean(),
+        }
+
+try:
+    g4version = subprocess.run(["geant4-config", "--version"], capture_output=True, text=True).stdout.strip()
+except OSError:
+    g4version = "unknown (geant4-config not found)"
+
+print()
+print("Geant4 {}, N = {} events per run".format(g4version, N))
+print()
+print("| {:10s} | {:>8s} | {:10s} | {:>10s} | {:>13s} | {:>16s} | {:>12s} | {:>12s} | {:>14s} |".format(
+    "Foil", "x/X0", "Mode", "Time [s]", "theta0 [mrad]", "theta_rms [mrad]", "f(>3theta0)", "Edep [MeV]", "E_exit [MeV]"))
+print("|" + "|".join(["-"*12, "-"*10, "-"*12, "-"*12, "-"*15, "-"*18, "-"*14, "-"*14, "-"*16]) + "|")
+for foilName, (mat, thick, radLength) in foils.items():
+    for mode in ("tracking", "fastSim"):
+        r = results[(foilName, mode)]
+        print("| {:10s} | {:8.5f} | {:10s} | {:10.1f} | {:13.4f} | {:16.4f} | {:12.5f} | {:12.5g} | {:14.6g} |".format(
+            foilName, thick/radLength, mode, r["time"], r["theta0"]*1e3, r["theta_rms"]*1e3,
+            r["tail"], r["edep"], r["E_exit"]))
@@ -18,6 +18,7 @@
 #include "DetectorConstruction.hh"
 #include "TargetSD.hh"
 #include "TrackerSD.hh"
+#include "TargetFastSimModel.hh"
 
 #include "MagnetClasses.hh"
 
@@ -45,6 +46,9 @@
 #include "G4UnitsTable.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4RunManager.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
 
 #include <cmath>
 #include <string>
@@ -184,6 +188,19 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
                                           false,                          //pMany not used
                                           0,                              //copy number
                                           true);                          //Check for overlaps
+
+        // Separate region for the target, so that it can have finer production cuts than the world
+        G4Region* targetRegion = G4RegionStore::GetInstance()->FindOrCreateRegion("Target");
+        targetRegion->AddRootLogicalVolume(logicTarget);
+        if (TargetCut >= 0.0) {
+            G4ProductionCuts* targetCuts = new G4ProductionCuts();
+            targetCuts->SetProductionCut(TargetCut);
+            targetRegion->SetProductionCuts(targetCuts);
+        }
+
+        if (TargetFastSim) {
+            new TargetFastSimModel("TargetFastSim", targetRegion, TargetThickness);
+        }
     }
     else {
         solidTarget = NULL;
@@ -214,6 +231,8 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
                                                           true);
 
         magnetPVs.push_back(magnetPV);
+
+        magnet->MakeRegion(ObjectCut);
     }
 
     return physiWorld;
@@ -221,6 +240,15 @@ G4VPhysicalVolume* DetectorConstruction::Construct() {
 
 //------------------------------------------------------------------------------
 
+G4bool DetectorConstruction::GetHasUserLimits() {
+    for (auto magnet : magnets) {
+        if (magnet->HasUserLimits()) return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+
 void DetectorConstruction::DefineMaterials() {
     // List of available materials:
     // http://geant4-userdoc.web.cern.ch/geant4-userdoc/UsersGuides/ForApplicationDeveloper/html/Appendix/materialNames.html
@@ -0,0 +1,83 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "EmOnlyPhysicsList.hh"
+
+#include "G4EmStandardPhysics.hh"
+#include "G4EmStandardPhysics_option1.hh"
+#include "G4EmStandardPhysics_option2.hh"
+#include "G4EmStandardPhysics_option3.hh"
+#include "G4EmStandardPhysics_option4.hh"
+#include "G4EmStandardPhysicsGS.hh"
+#include "G4EmStandardPhysicsSS.hh"
+#include "G4EmLivermorePhysics.hh"
+#include "G4EmPenelopePhysics.hh"
+#include "G4EmExtraPhysics.hh"
+#include "G4DecayPhysics.hh"
+
+EmOnlyPhysicsList::EmOnlyPhysicsList(G4String physListName) : G4VModularPhysicsList() {
+    if (not IsEmOnlyName(physListName)) {
+        G4cerr << "Error in EmOnlyPhysicsList: '" << physListName << "' is not an EMonly physics list" << G4endl;
+        exit(1);
+    }
+
+    G4String option = physListName(6, physListName.length()-6);
+    G4bool gammaNuclear = false;
+    if (option.index("_GN") == 0) {
+        gammaNuclear = true;
+        option = option(3, option.length()-3);
+    }
+
+    G4VPhysicsConstructor* emPhysics = NULL;
+    if      (option == ""    ) emPhysics = new G4EmStandardPhysics();
+    else if (option == "_EMV") emPhysics = new G4EmStandardPhysics_option1();
+    else if (option == "_EMX") emPhysics = new G4EmStandardPhysics_option2();
+    else if (option == "_EMY") emPhysics = new G4EmStandardPhysics_option3();
+    else if (option == "_EMZ") emPhysics = new G4EmStandardPhysics_option4();
+    else if (option == "__GS") emPhysics = new G4EmStandardPhysicsGS();
+    else if (option == "__SS") emPhysics = new G4EmStandardPhysicsSS();
+    else if (option == "_LIV") emPhysics = new G4EmLivermorePhysics();
+    else if (option == "_PEN") emPhysics = new G4EmPenelopePhysics();
+    else {
+        G4cerr << "Error in EmOnlyPhysicsList: Unknown EM option '" << option << "' "
+               << "in physics list '" << physListName << "'" << G4endl;
+        PrintNames();
+        exit(1);
+    }
+    RegisterPhysics(emPhysics);
+
+    // Also constructs all the particles, which may be produced e.g. by gamma-nuclear reactions
+    RegisterPhysics(new G4DecayPhysics());
+
+    if (gammaNuclear) {
+        RegisterPhysics(new G4EmExtraPhysics());
+    }
+
+    G4cout << "Using the lightweight physics list '" << physListName << "' "
+           << "(" << emPhysics->GetPhysicsName() << ", decays"
+           << (gammaNuclear ? ", gamma- and lepto-nuclear" : "") << ")" << G4endl;
+}
+
+G4bool EmOnlyPhysicsList::IsEmOnlyName(G4String physListName) {
+    return physListName.index("EMonly") == 0;
+}
+
+void EmOnlyPhysicsList::PrintNames() {
+    G4cerr << "'EMonly[_GN][EM option]', where '_GN' adds gamma- and lepto-nuclear reactions," << G4endl
+           << " and the EM option is one of '', '_EMV', '_EMX', '_EMY', '_EMZ', '__GS', '__SS', '_LIV', '_PEN'" << G4endl
+           << " (e.g. 'EMonly', 'EMonly_EMZ', 'EMonly_GN')" << G4endl;
+}
@@ -0,0 +1,94 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "EmPresets.hh"
+
+#include "G4EmParameters.hh"
+#include "G4MscStepLimitType.hh"
+#include "G4SystemOfUnits.hh"
+
+const std::vector<G4String>& EmPresets::GetPresetNames() {
+    static const std::vector<G4String> presetNames = {"precise-thin-foil", "balanced", "fast-shielding"};
+    return presetNames;
+}
+
+void EmPresets::CheckPresetName(G4String preset, G4String where) {
+    for (auto& name : GetPresetNames()) {
+        if (preset == name) return;
+    }
+    G4cerr << "Error: Unknown EM preset '" << preset << "' for " << where << "; possibilities:" << G4endl;
+    for (auto& name : GetPresetNames()) {
+        G4cerr << "'" << name << "'" << G4endl;
+    }
+    exit(1);
+}
+
+void EmPresets::ApplyGlobal(G4String preset) {
+    CheckPresetName(preset, "--emPreset");
+    G4EmParameters* param = G4EmParameters::Instance();
+
+    if (preset == "precise-thin-foil") {
+        // As G4EmStandardPhysics_option4, with the Mott correction to single scattering
+        param->SetMscStepLimitType(fUseSafetyPlus);
+        param->SetMscRangeFactor(0.08);
+        param->SetMscSkin(3);
+        param->SetUseMottCorrection(true);
+        param->SetLossFluctuations(true);
+        param->SetLowestElectronEnergy(100*eV);
+        param->SetStepFunction(0.2, 10*um);
+    }
+    else if (preset == "balanced") {
+        // The G4EmParameters defaults, i.e. G4EmStandardPhysics
+        param->SetMscStepLimitType(fUseSafety);
+        param->SetMscRangeFactor(0.04);
+        param->SetMscSkin(1);
+        param->SetUseMottCorrection(false);
+        param->SetLossFluctuations(true);
+        param->SetLowestElectronEnergy(1*keV);
+        param->SetStepFunction(0.2, 1*mm);
+    }
+    else if (preset == "fast-shielding") {
+        // Electrons below 100 keV have a range of at most ~0.1 mm in metals,
+        // and are stopped where they are; fluctuations are kept for the edep spectra
+        param->SetMscStepLimitType(fMinimal);
+        param->SetMscRangeFactor(0.2);
+        param->SetMscSkin(1);
+        param->SetUseMottCorrection(false);
+        param->SetLossFluctuations(true);
+        param->SetLowestElectronEnergy(100*keV);
+        param->SetStepFunction(0.8, 1*mm);
+    }
+
+    G4cout << "Using the EM preset '" << preset << "'" << G4endl;
+}
+
+G4String EmPresets::GetRegionPhysics(G4String preset) {
+    if (preset == "precise-thin-foil") return "G4EmStandard_opt4";
+    if (preset == "fast-shielding")    return "G4EmStandard_opt1";
+    return "G4EmStandard";
+}
+
+void EmPresets::ApplyRegion(G4String preset, G4String regionName) {
+    CheckPresetName(preset, "region '" + regionName + "'");
+    const G4String regionPhysics = GetRegionPhysics(preset);
+    // Activated by the EM constructor of the physics list when the processes are built,
+    // after the geometry (and thus the region) has been constructed
+    G4EmParameters::Instance()->AddPhysics(regionName, regionPhysics);
+
+    G4cout << "Using the EM preset '" << preset << "' (" << regionPhysics << ") "
+           << "in the region '" << regionName << "'" << G4endl;
+}
@@ -28,6 +28,7 @@
 #include "G4UImanager.hh"
 #include "G4Event.hh"
 #include "G4SystemOfUnits.hh"
+#include "G4RunManager.hh"
 #include <iomanip>
 
 #include <iostream>
@@ -45,6 +46,13 @@ EventAction::EventAction(RunAction* run) : runAct(run) {}
 void EventAction::EndOfEventAction(const G4Event* event) {
     RootFileWriter::GetInstance()->doEvent(event);
 
+    // Stop early if the requested statistical precision has been reached,
+    // the maximum wall time is exceeded, or on SIGTERM/SIGINT/SIGUSR1;
+    // the current event is completed, and the output is written as usual.
+    if (RootFileWriter::GetInstance()->StopRequested()) {
+        G4RunManager::GetRunManager()->AbortRun(true);
+    }
+
     G4int eventID = event->GetEventID();
     if (eventID % 500 == 0) {
         G4cout << "Event# "<<event->GetEventID() << G4endl;
@@ -0,0 +1,117 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "EventReplay.hh"
+#include "SplitString.hh"
+
+#include "Randomize.hh"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TLeaf.h"
+
+#include <sstream>
+#include <set>
+
+void EventReplay::Load(G4String replayString) {
+    // Split 'file.root:id1,id2,...'
+    G4String fileName = replayString;
+    std::set<Long64_t> selectedIDs;
+    str_size colonPos = replayString.index(":");
+    if (colonPos != std::string::npos) {
+        fileName = replayString(0,colonPos);
+        for (auto idString : SplitString(replayString(colonPos+1,std::string::npos), ",")) {
+            try {
+                selectedIDs.insert(std::stoll(idString));
+            }
+            catch (const std::invalid_argument& ia) {
+                G4cerr << "Error when parsing replay string '" << replayString << "':" << G4endl
+                       << " Expected an integer eventID, got '" << idString << "'" << G4endl;
+                exit(1);
+            }
+        }
+    }
+
+    TFile* replayFile = new TFile(fileName, "READ");
+    if ( not replayFile->IsOpen() ) {
+        G4cerr << "Opening replay file '" << fileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    TTree* eventRNG = (TTree*) replayFile->Get("eventRNG");
+    if (eventRNG == NULL) {
+        G4cerr << "Error: No eventRNG TTree in '" << fileName << "'; was it written with --recordRNG?" << G4endl;
+        exit(1);
+    }
+
+    Long64_t     eventID   = 0;
+    Int_t        eventID32 = 0; // Files written before the eventIDs were 64-bit
+    std::string* rngState  = NULL;
+    Double_t     x, xp, y, yp, E;
+    const G4bool oldEventID = G4String(eventRNG->GetLeaf("eventID")->GetTypeName()) == "Int_t";
+    if (oldEventID) {
+        eventRNG->SetBranchAddress("eventID", &eventID32);
+    }
+    else {
+        eventRNG->SetBranchAddress("eventID", &eventID);
+    }
+    eventRNG->SetBranchAddress("rngState", &rngState);
+    eventRNG->SetBranchAddress("x",        &x);
+    eventRNG->SetBranchAddress("xp",       &xp);
+    eventRNG->SetBranchAddress("y",        &y);
+    eventRNG->SetBranchAddress("yp",       &yp);
+    eventRNG->SetBranchAddress("E",        &E);
+
+    events.clear();
+    nextEvent = 0;
+    for (Long64_t i = 0; i < eventRNG->GetEntries(); i++) {
+        eventRNG->GetEntry(i);
+        if (oldEventID) eventID = eventID32;
+        if (not selectedIDs.empty() and selectedIDs.count(eventID) == 0) continue;
+        events.push_back({eventID, *rngState, x, xp, y, yp, E});
+    }
+
+    for (auto id : selectedIDs) {
+        G4bool found = false;
+        for (auto& ev : events) {
+            if (ev.eventID == id) { found = true; break; }
+        }
+        if (not found) {
+            G4cerr << "Error: eventID " << id << " was not recorded in '" << fileName << "'" << G4endl;
+            exit(1);
+        }
+    }
+
+    delete rngState;
+    replayFile->Close();
+    delete replayFile;
+
+    G4cout << "Loaded " << events.size() << " events for replay from '" << fileName << "'" << G4endl;
+}
+
+const replayEvent& EventReplay::Next() {
+    if (nextEvent >= events.size()) {
+        G4cerr << "Error in EventReplay::Next(): No more recorded events." << G4endl;
+        exit(1);
+    }
+    const replayEvent& ev = events[nextEvent++];
+
+    std::istringstream rngState(ev.rngState);
+    G4Random::restoreFullState(rngState);
+
+    G4cout << "Replaying recorded event " << ev.eventID << G4endl;
+    return ev;
+}
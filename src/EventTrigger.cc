@@ -0,0 +1,154 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "EventTrigger.hh"
+#include "SplitString.hh"
+
+#include <string>
+
+void EventTrigger::Parse(G4String triggerString) {
+    definition = triggerString;
+    active     = true;
+    clauses.clear();
+
+    //Split by '|', then by '&'
+    for (auto clauseString : SplitString(triggerString, "|")) {
+        clauses.push_back(std::vector<triggerCondition>());
+        for (auto condString : SplitString(clauseString, "&")) {
+            clauses.back().push_back(ParseCondition(condString));
+        }
+    }
+}
+
+EventTrigger::triggerCondition EventTrigger::ParseCondition(G4String condString) {
+    triggerCondition cond;
+
+    str_size dotPos = condString.index(".",0);
+    if (dotPos == std::string::npos) {
+        G4cerr << "Error when parsing trigger condition '" << condString << "', "
+               << "expected 'detector.quantity<op>value'." << G4endl;
+        exit(1);
+    }
+    cond.detName = condString(0,dotPos);
+    cond.detIdx  = -1;
+
+    str_size opPos = condString.index("<",0);
+    if (opPos == std::string::npos) {
+        opPos = condString.index(">",0);
+    }
+    if (opPos == std::string::npos or opPos < dotPos) {
+        G4cerr << "Error when parsing trigger condition '" << condString << "', "
+               << "no operator '>', '<', '>=' or '<=' found." << G4endl;
+        exit(1);
+    }
+    G4String quantity = condString(dotPos+1,opPos-dotPos-1);
+    str_size valPos = opPos+1;
+    G4bool orEqual = (valPos < condString.length() and condString[valPos] == '=');
+    if (orEqual) valPos++;
+    if (condString[opPos] == '>') cond.op = orEqual ? GE : GT;
+    else                          cond.op = orEqual ? LE : LT;
+
+    if      (quantity == "nHits")    cond.quantity = NHITS;
+    else if (quantity == "nOutside") cond.quantity = NOUTSIDE;
+    else if (quantity == "maxR")     cond.quantity = MAXR;
+    else if (quantity == "maxE")     cond.quantity = MAXE;
+    else if (quantity == "edep")     cond.quantity = EDEP;
+    else {
+        G4cerr << "Error when parsing trigger condition '" << condString << "', "
+               << "unknown quantity '" << quantity << "'." << G4endl
+               << "Expected one of 'nHits', 'nOutside', 'maxR', 'maxE', 'edep'." << G4endl;
+        exit(1);
+    }
+
+    G4String valString = condString(valPos,std::string::npos);
+    try {
+        cond.value = std::stod(std::string(valString));
+    }
+    catch (const std::invalid_argument& ia) {
+        G4cerr << "Invalid argument when reading trigger condition '" << condString << "'" << G4endl
+               << "Got: '" << valString << "'" << G4endl
+               << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+        exit(1);
+    }
+
+    return cond;
+}
+
+G4int EventTrigger::RegisterDetector(G4String name) {
+    if (detectorIndex.find(name) == detectorIndex.end()) {
+        detectorIndex[name] = summaries.size();
+        summaries.push_back(triggerDetectorSummary());
+        summaries.back().Reset();
+    }
+    return detectorIndex[name];
+}
+
+void EventTrigger::Resolve() {
+    for (auto& clause : clauses) {
+        for (auto& cond : clause) {
+            auto it = detectorIndex.find(cond.detName);
+            if (it == detectorIndex.end()) {
+                G4cerr << "Error in event trigger '" << definition << "': "
+                       << "unknown detector '" << cond.detName << "'." << G4endl
+                       << "Available detectors:";
+                for (auto det : detectorIndex) {
+                    G4cerr << " '" << det.first << "'";
+                }
+                G4cerr << G4endl;
+                exit(1);
+            }
+            cond.detIdx = it->second;
+        }
+    }
+
+    G4cout << "Event trigger '" << definition << "' uses position_cutoffR = "
+           << position_cutoffR << " [mm] for nOutside." << G4endl;
+}
+
+G4bool EventTrigger::Evaluate() {
+    numEvaluated++;
+    for (auto& clause : clauses) {
+        G4bool clausePass = true;
+        for (auto& cond : clause) {
+            const triggerDetectorSummary& s = summaries[cond.detIdx];
+            G4double q = 0.0;
+            switch (cond.quantity) {
+            case NHITS:    q = s.nHits;    break;
+            case NOUTSIDE: q = s.nOutside; break;
+            case MAXR:     q = s.maxR;     break;
+            case MAXE:     q = s.maxE;     break;
+            case EDEP:     q = s.edep;     break;
+            }
+            G4bool condPass = false;
+            switch (cond.op) {
+            case GT: condPass = (q >  cond.value); break;
+            case LT: condPass = (q <  cond.value); break;
+            case GE: condPass = (q >= cond.value); break;
+            case LE: condPass = (q <= cond.value); break;
+            }
+            if (not condPass) {
+                clausePass = false;
+                break;
+            }
+        }
+        if (clausePass) {
+            numPassed++;
+            return true;
+        }
+    }
+    return false;
+}
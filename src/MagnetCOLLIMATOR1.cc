@@ -44,6 +44,15 @@ MagnetCOLLIMATOR1::MagnetCOLLIMATOR1(G4double zPos_in, G4bool doRelPos_in, G4dou
         else if (it.first == "xOffset" || it.first == "yOffset" || it.first == "xRot" || it.first == "yRot") {
             ParseOffsetRot(it.first, it.second);
         }
+        else if (it.first == "cut") {
+            ParseRegionCut(it.second);
+        }
+        else if (it.first == "minEkin" || it.first == "maxTrackLength" || it.first == "maxTime") {
+            ParseUserLimits(it.first, it.second);
+        }
+        else if (it.first == "emPreset") {
+            ParseEmPreset(it.second);
+        }
         else {
             G4cerr << "MagnetCOLLIMATOR1 did not understand key=value pair '"
                    << it.first << "'='" << it.second << "'." << G4endl;
@@ -39,6 +39,13 @@
 
 #include "G4VisAttributes.hh"
 
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4ProductionCuts.hh"
+#include "G4UserLimits.hh"
+
+#include "EmPresets.hh"
+
 MagnetBase* MagnetBase::MagnetFactory(G4String inputString, DetectorConstruction* detCon, G4String magnetName) {
 
     //Split by '::'
@@ -287,6 +294,60 @@ void MagnetBase::ParseOffsetRot(G4String k, G4String v) {
     }
 }
 
+void MagnetBase::ParseRegionCut(G4String v) {
+    regionCut = ParseDouble(v, "cut") * mm;
+    if (regionCut < 0.0) {
+        G4cerr << "Error: The production cut for '" << magnetName << "' must be >= 0, got "
+               << regionCut/mm << " [mm]" << G4endl;
+        exit(1);
+    }
+}
+
+void MagnetBase::MakeRegion(G4double defaultCut) {
+    G4Region* region = G4RegionStore::GetInstance()->FindOrCreateRegion(magnetName);
+    region->AddRootLogicalVolume(GetMainLV());
+
+    const G4double cut = (regionCut >= 0.0) ? regionCut : defaultCut;
+    if (cut >= 0.0) {
+        G4ProductionCuts* cuts = new G4ProductionCuts();
+        cuts->SetProductionCut(cut);
+        region->SetProductionCuts(cuts);
+    }
+    // Else Geant4 uses the default cuts of the world
+
+    if (hasUserLimits) {
+        region->SetUserLimits(new G4UserLimits(DBL_MAX, maxTrackLength, maxTime, minEkin));
+    }
+}
+
+void MagnetBase::ParseUserLimits(G4String k, G4String v) {
+    hasUserLimits = true;
+    G4double val = ParseDouble(v, k);
+    if (val <= 0.0) {
+        G4cerr << "Error: '" << k << "' for '" << magnetName << "' must be > 0, got " << val << G4endl;
+        exit(1);
+    }
+    if (k == "minEkin") {
+        minEkin = val * MeV;
+    }
+    else if (k == "maxTrackLength") {
+        maxTrackLength = val * mm;
+    }
+    else if (k == "maxTime") {
+        maxTime = val * ns;
+    }
+    else {
+        G4cerr << "MagnetBase::ParseUserLimits() cannot parse key '" << k << "' "
+               << "(value = '" << v << "')" << G4endl;
+        exit(1);
+    }
+}
+
+void MagnetBase::ParseEmPreset(G4String v) {
+    EmPresets::CheckPresetName(v, "'" + magnetName + "'");
+    emPreset = v;
+}
+
 void MagnetBase::PrintCommonParameters() {
     G4cout << "Initialized a " << magnetType << ", parameters:" <<             G4endl;
     G4cout << "\t magnetName              = " << magnetName         <<             G4endl;
@@ -297,6 +358,17 @@ void MagnetBase::PrintCommonParameters() {
     G4cout << "\t yOffset                 = " << yOffset/mm         << " [mm]"  << G4endl;
     G4cout << "\t xRot                    = " << xRot/deg           << " [deg]" << G4endl;
     G4cout << "\t yRot                    = " << yRot/deg           << " [deg]" << G4endl;
+    if (regionCut >= 0.0) {
+        G4cout << "\t cut                     = " << regionCut/mm       << " [mm]"  << G4endl;
+    }
+    if (hasUserLimits) {
+        G4cout << "\t minEkin                 = " << minEkin/MeV        << " [MeV]" << G4endl;
+        G4cout << "\t maxTrackLength          = " << maxTrackLength/mm  << " [mm]"  << G4endl;
+        G4cout << "\t maxTime                 = " << maxTime/ns         << " [ns]"  << G4endl;
+    }
+    if (emPreset != "") {
+        G4cout << "\t emPreset                = " << emPreset                       << G4endl;
+    }
 }
 
 /** FIELD PATTERN BASE CLASS **/
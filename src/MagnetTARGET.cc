@@ -40,6 +40,15 @@ MagnetTARGET::MagnetTARGET(G4double zPos_in, G4bool doRelPos_in, G4double length
         else if (it.first == "xOffset" || it.first == "yOffset" || it.first == "xRot" || it.first == "yRot") {
             ParseOffsetRot(it.first, it.second);
         }
+        else if (it.first == "cut") {
+            ParseRegionCut(it.second);
+        }
+        else if (it.first == "minEkin" || it.first == "maxTrackLength" || it.first == "maxTime") {
+            ParseUserLimits(it.first, it.second);
+        }
+        else if (it.first == "emPreset") {
+            ParseEmPreset(it.second);
+        }
         else {
             G4cerr << "MagnetTARGET did not understand key=value pair '"
                    << it.first << "'='" << it.second << "'." << G4endl;
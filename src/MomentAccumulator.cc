@@ -0,0 +1,64 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MomentAccumulator.hh"
+
+void MomentAccumulator2D::Merge(const MomentAccumulator2D& other) {
+    if (other.n == 0) return;
+    if (n == 0) {
+        *this = other;
+        return;
+    }
+
+    const G4double nA = n;
+    const G4double nB = other.n;
+    const G4double nAB = nA + nB;
+    const G4double dU = other.meanU - meanU;
+    const G4double dV = other.meanV - meanV;
+
+    meanU += dU * nB / nAB;
+    meanV += dV * nB / nAB;
+    M2U   += other.M2U + dU * dU * nA * nB / nAB;
+    M2V   += other.M2V + dV * dV * nA * nB / nAB;
+    CUV   += other.CUV + dU * dV * nA * nB / nAB;
+    n     += other.n;
+}
+
+TVectorD MomentAccumulator2D::GetRawMoments() const {
+    TVectorD raw(numRawMoments);
+    raw[0] = double(n);
+    raw[1] = meanU;
+    raw[2] = meanV;
+    raw[3] = M2U;
+    raw[4] = M2V;
+    raw[5] = CUV;
+    return raw;
+}
+
+void MomentAccumulator2D::SetRawMoments(const TVectorD& raw) {
+    if (raw.GetNrows() != numRawMoments) {
+        G4cerr << "Error in MomentAccumulator2D::SetRawMoments: Expected "
+               << numRawMoments << " elements, got " << raw.GetNrows() << G4endl;
+        exit(1);
+    }
+    n     = G4long(raw[0]);
+    meanU = raw[1];
+    meanV = raw[2];
+    M2U   = raw[3];
+    M2V   = raw[4];
+    CUV   = raw[5];
+}
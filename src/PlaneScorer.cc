@@ -0,0 +1,189 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PlaneScorer.hh"
+#include "SplitString.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4ParticleDefinition.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+PlaneScorer::PlaneScorer(G4String planesString, G4double angle_in) {
+    angle  = angle_in*deg;
+    normal = G4ThreeVector(sin(angle), 0.0, cos(angle));
+    if ( fabs(angle_in) > 89.0) {
+        G4cerr << "Error: The angle of the scoring planes is too close to or above 90 degrees, "
+               << angle_in << " [deg]" << G4endl;
+        exit(1);
+    }
+
+    // Split by ':' (list) or ',' (range)
+    const char* sep = (planesString.index(",",0) != std::string::npos) ? "," : ":";
+    std::vector<G4double> values;
+    for (auto valStr : SplitString(planesString, sep)) {
+        try {
+            values.push_back(std::stod(std::string(valStr)));
+        }
+        catch (const std::invalid_argument& ia) {
+            G4cerr << "Invalid argument when reading the scoring planes" << G4endl
+                   << "Got: '" << valStr << "' in '" << planesString << "'" << G4endl
+                   << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+            exit(1);
+        }
+    }
+
+    if (std::string(sep) == ",") {
+        if (values.size() != 3 or values[2] < 1 or values[2] != floor(values[2])) {
+            G4cerr << "Error: A range of scoring planes must be given as 'first,last,num', got '"
+                   << planesString << "'" << G4endl;
+            exit(1);
+        }
+        const G4long num = G4long(values[2]);
+        for (G4long i = 0; i < num; i++) {
+            const G4double d = (num == 1) ? values[0] : values[0] + (values[1]-values[0]) * i / G4double(num-1);
+            planeDistances.push_back(d*mm);
+        }
+    }
+    else {
+        for (auto d : values) {
+            planeDistances.push_back(d*mm);
+        }
+    }
+    std::sort(planeDistances.begin(), planeDistances.end());
+    if (std::adjacent_find(planeDistances.begin(), planeDistances.end()) != planeDistances.end()) {
+        G4cerr << "Error: Two scoring planes are at the same position in '" << planesString << "'" << G4endl;
+        exit(1);
+    }
+
+    // Sorted as the distances, since cos(angle) > 0
+    for (auto d : planeDistances) {
+        planePos.push_back(d*cos(angle));
+    }
+
+    numHits.resize(planeDistances.size());
+    momentsX.resize(planeDistances.size());
+    momentsY.resize(planeDistances.size());
+    momentsX_cutoff.resize(planeDistances.size());
+    momentsY_cutoff.resize(planeDistances.size());
+    Reset();
+}
+
+std::vector<G4double> PlaneScorer::GetDistances_mm() const {
+    std::vector<G4double> distances_mm;
+    for (auto d : planeDistances) {
+        distances_mm.push_back(d/mm);
+    }
+    return distances_mm;
+}
+
+void PlaneScorer::Reset() {
+    for (size_t idx = 0; idx < planeDistances.size(); idx++) {
+        numHits[idx] = 0;
+        momentsX[idx].Reset();
+        momentsY[idx].Reset();
+        momentsX_cutoff[idx].Reset();
+        momentsY_cutoff[idx].Reset();
+    }
+}
+
+TMatrixD PlaneScorer::GetState() const {
+    const G4int numRaw = MomentAccumulator2D::numRawMoments;
+    TMatrixD state(planeDistances.size(), 1 + 4*numRaw);
+    for (size_t idx = 0; idx < planeDistances.size(); idx++) {
+        state(idx, 0) = double(numHits[idx]);
+        G4int col = 1;
+        for (auto moments : {&momentsX, &momentsY, &momentsX_cutoff, &momentsY_cutoff}) {
+            const TVectorD raw = (*moments)[idx].GetRawMoments();
+            for (G4int i = 0; i < numRaw; i++) {
+                state(idx, col++) = raw[i];
+            }
+        }
+    }
+    return state;
+}
+
+void PlaneScorer::SetState(const TMatrixD& state) {
+    const G4int numRaw = MomentAccumulator2D::numRawMoments;
+    if (state.GetNrows() != G4int(planeDistances.size()) or state.GetNcols() != 1 + 4*numRaw) {
+        G4cerr << "Error when reading checkpoint: Expected " << planeDistances.size() << " planes, got "
+               << state.GetNrows() << G4endl;
+        exit(1);
+    }
+    for (size_t idx = 0; idx < planeDistances.size(); idx++) {
+        numHits[idx] = G4long(state(idx, 0));
+        G4int col = 1;
+        for (auto moments : {&momentsX, &momentsY, &momentsX_cutoff, &momentsY_cutoff}) {
+            TVectorD raw(numRaw);
+            for (G4int i = 0; i < numRaw; i++) {
+                raw[i] = state(idx, col++);
+            }
+            (*moments)[idx].SetRawMoments(raw);
+        }
+    }
+}
+
+void PlaneScorer::ScoreStep(const G4Step* step) {
+    const G4StepPoint* preStepPoint  = step->GetPreStepPoint();
+    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+    ScoreSegment(preStepPoint->GetPosition(),      postStepPoint->GetPosition(),
+                 preStepPoint->GetMomentum(),      postStepPoint->GetMomentum(),
+                 preStepPoint->GetKineticEnergy(), postStepPoint->GetKineticEnergy(),
+                 step->GetTrack()->GetDefinition());
+}
+
+void PlaneScorer::ScoreSegment(const G4ThreeVector& pos0, const G4ThreeVector& pos1,
+                               const G4ThreeVector& mom0, const G4ThreeVector& mom1,
+                               G4double E0, G4double E1, const G4ParticleDefinition* particleType) {
+    const G4double u0 = normal.dot(pos0);
+    const G4double u1 = normal.dot(pos1);
+    if (u0 == u1) return;
+
+    // The planes in (u0,u1] going forward, or in [u1,u0) going backward,
+    // so that a plane at the end of a step is counted once
+    size_t first, last;
+    if (u1 > u0) {
+        first = std::upper_bound(planePos.begin(), planePos.end(), u0) - planePos.begin();
+        last  = std::upper_bound(planePos.begin(), planePos.end(), u1) - planePos.begin();
+    }
+    else {
+        first = std::lower_bound(planePos.begin(), planePos.end(), u1) - planePos.begin();
+        last  = std::lower_bound(planePos.begin(), planePos.end(), u0) - planePos.begin();
+    }
+    if (first >= last) return;
+
+    const G4bool charged = particleType->GetPDGCharge() != 0.0;
+    for (size_t idx = first; idx < last; idx++) {
+        const G4double f = (planePos[idx] - u0) / (u1 - u0);
+        const G4ThreeVector hitPos   = pos0 + f*(pos1 - pos0);
+        const G4ThreeVector momentum = mom0 + f*(mom1 - mom0);
+        const G4double      energy   = E0 + f*(E1 - E0);
+        const G4double      hitR     = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
+
+        numHits[idx]++;
+        momentsX[idx].Fill(hitPos.x()/mm, momentum.x()/momentum.z());
+        momentsY[idx].Fill(hitPos.y()/mm, momentum.y()/momentum.z());
+        if (charged and energy/MeV > energyCut and hitR/mm < radiusCut) {
+            momentsX_cutoff[idx].Fill(hitPos.x()/mm, momentum.x()/momentum.z());
+            momentsY_cutoff[idx].Fill(hitPos.y()/mm, momentum.y()/momentum.z());
+        }
+    }
+}
@@ -0,0 +1,213 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "PrecisionMonitor.hh"
+#include "SplitString.hh"
+
+#include <string>
+#include <cmath>
+#include <iomanip>
+
+void PrecisionMonitor::Parse(G4String precisionString) {
+    definition = precisionString;
+    active     = true;
+    targets.clear();
+    batchMoments.clear();
+
+    for (auto targetString : SplitString(precisionString, ",")) {
+        targets.push_back(ParseTarget(targetString));
+        batchMoments[targets.back().phaseSpaceName] = MomentAccumulator2D();
+    }
+}
+
+std::vector<G4String> PrecisionMonitor::GetPhaseSpaceNames() const {
+    std::vector<G4String> names;
+    for (auto& it : batchMoments) {
+        names.push_back(it.first);
+    }
+    return names;
+}
+
+PrecisionMonitor::precisionTarget PrecisionMonitor::ParseTarget(G4String targetString) {
+    precisionTarget target;
+
+    str_size colPos1 = targetString.index(":",0);
+    str_size colPos2 = (colPos1 == std::string::npos) ? colPos1 : targetString.index(":",colPos1+1);
+    if (colPos2 == std::string::npos) {
+        G4cerr << "Error when parsing precision target '" << targetString << "', "
+               << "expected 'phaseSpace:quantity:relErr'." << G4endl;
+        exit(1);
+    }
+    target.phaseSpaceName = targetString(0,colPos1);
+    target.quantityName   = targetString(colPos1+1,colPos2-colPos1-1);
+
+    if      (target.quantityName == "eps")    target.quantity = EPS;
+    else if (target.quantityName == "beta")   target.quantity = BETA;
+    else if (target.quantityName == "posRMS") target.quantity = POSRMS;
+    else if (target.quantityName == "angRMS") target.quantity = ANGRMS;
+    else if (target.quantityName == "n")      target.quantity = NPART;
+    else {
+        G4cerr << "Error when parsing precision target '" << targetString << "', "
+               << "unknown quantity '" << target.quantityName << "'." << G4endl
+               << "Expected one of 'eps', 'beta', 'posRMS', 'angRMS', 'n'." << G4endl;
+        exit(1);
+    }
+
+    G4String valString = targetString(colPos2+1,std::string::npos);
+    try {
+        target.relErr_target = std::stod(std::string(valString));
+    }
+    catch (const std::invalid_argument& ia) {
+        G4cerr << "Invalid argument when reading precision target '" << targetString << "'" << G4endl
+               << "Got: '" << valString << "'" << G4endl
+               << "Expected a floating point number! (exponential notation is accepted)" << G4endl;
+        exit(1);
+    }
+    if (target.relErr_target <= 0.0) {
+        G4cerr << "Error in precision target '" << targetString << "': relErr must be > 0." << G4endl;
+        exit(1);
+    }
+
+    return target;
+}
+
+void PrecisionMonitor::Print() const {
+    G4cout << "Stopping the run when the relative uncertainty of all these observables is reached, "
+           << "estimated from batches of " << batchSize << " events:" << G4endl;
+    for (auto& target : targets) {
+        G4cout << "  " << target.phaseSpaceName << " : " << target.quantityName
+               << " < " << target.relErr_target << G4endl;
+    }
+    G4cout << G4endl;
+}
+
+G4double PrecisionMonitor::ComputeBatchValue(const precisionTarget& target) const {
+    const MomentAccumulator2D& m = batchMoments.at(target.phaseSpaceName);
+    if (target.quantity == NPART) {
+        return double(m.GetN()) / double(batchEvents);
+    }
+
+    if (m.GetN() < 2) return NAN;
+    const G4double eps = sqrt(m.GetVarU()*m.GetVarV() - m.GetCovUV()*m.GetCovUV());
+    switch (target.quantity) {
+    case EPS:    return eps;
+    case BETA:   return m.GetVarU() / eps;
+    case POSRMS: return sqrt(m.GetVarU());
+    case ANGRMS: return sqrt(m.GetVarV());
+    default:     return NAN;
+    }
+}
+
+G4double PrecisionMonitor::precisionTarget::GetRelErr() const {
+    if (numBatches < 2 or batchMean == 0.0) return INFINITY;
+    // Standard error of the mean of the batches
+    return sqrt(batchM2 / (numBatches-1) / numBatches) / fabs(batchMean);
+}
+
+void PrecisionMonitor::EndOfEvent() {
+    batchEvents++;
+    if (batchEvents < batchSize) return;
+
+    // Close the batch
+    G4bool allConverged = true;
+    for (auto& target : targets) {
+        G4double value = ComputeBatchValue(target);
+        if (not std::isnan(value)) {
+            target.numBatches++;
+            G4double delta = value - target.batchMean;
+            target.batchMean += delta / target.numBatches;
+            target.batchM2   += delta * (value - target.batchMean);
+        }
+        if (target.numBatches < minBatches or target.GetRelErr() > target.relErr_target) {
+            allConverged = false;
+        }
+    }
+    for (auto& it : batchMoments) {
+        it.second.Reset();
+    }
+    batchEvents = 0;
+
+    if (allConverged and not converged) {
+        converged = true;
+        G4cout << "Precision targets reached:" << G4endl;
+        for (auto& target : targets) {
+            G4cout << "  " << target.phaseSpaceName << " : " << target.quantityName
+                   << " = " << target.batchMean << " +/- " << target.GetRelErr()*100 << " %"
+                   << " (" << target.numBatches << " batches)" << G4endl;
+        }
+        G4cout << G4endl;
+    }
+}
+
+G4String PrecisionMonitor::GetTargetName(size_t i) const {
+    return targets[i].phaseSpaceName + "_" + targets[i].quantityName;
+}
+
+TVectorD PrecisionMonitor::GetResult(size_t i) const {
+    TVectorD result(5);
+    result[0] = targets[i].relErr_target;
+    result[1] = targets[i].GetRelErr();
+    result[2] = targets[i].batchMean;
+    result[3] = double(targets[i].numBatches);
+    result[4] = double(batchSize);
+    return result;
+}
+
+TVectorD PrecisionMonitor::GetState() const {
+    const G4int numMoments = MomentAccumulator2D::numRawMoments;
+    TVectorD state(2 + 3*targets.size() + numMoments*batchMoments.size());
+    G4int idx = 0;
+    state[idx++] = double(batchEvents);
+    state[idx++] = converged ? 1.0 : 0.0;
+    for (auto& target : targets) {
+        state[idx++] = double(target.numBatches);
+        state[idx++] = target.batchMean;
+        state[idx++] = target.batchM2;
+    }
+    for (auto& it : batchMoments) {
+        TVectorD moments = it.second.GetRawMoments();
+        for (G4int i = 0; i < numMoments; i++) {
+            state[idx++] = moments[i];
+        }
+    }
+    return state;
+}
+
+void PrecisionMonitor::SetState(const TVectorD& state) {
+    const G4int numMoments = MomentAccumulator2D::numRawMoments;
+    if (state.GetNrows() != G4int(2 + 3*targets.size() + numMoments*batchMoments.size())) {
+        G4cerr << "Error in PrecisionMonitor::SetState(): The saved state does not match the precision targets '"
+               << definition << "'." << G4endl;
+        exit(1);
+    }
+    G4int idx = 0;
+    batchEvents = G4int(state[idx++]);
+    converged   = (state[idx++] != 0.0);
+    for (auto& target : targets) {
+        target.numBatches = G4long(state[idx++]);
+        target.batchMean  = state[idx++];
+        target.batchM2    = state[idx++];
+    }
+    // The batch moments are updated in place, since the phase spaces hold pointers to them
+    for (auto& it : batchMoments) {
+        TVectorD moments(numMoments);
+        for (G4int i = 0; i < numMoments; i++) {
+            moments[i] = state[idx++];
+        }
+        it.second.SetRawMoments(moments);
+    }
+}
@@ -27,6 +27,7 @@
 #include "G4String.hh"
 
 #include <iostream>
+#include <sstream>
 #include <cmath>
 #include <string>
 
@@ -88,6 +89,13 @@ PrimaryGeneratorAction::~PrimaryGeneratorAction() {
     delete particleGun;
 }
 
+void PrimaryGeneratorAction::SetRNG(TRandom* RNG_in) {
+    if (RNG != NULL) {
+        delete RNG;
+    }
+    RNG = RNG_in;
+}
+
 
 void PrimaryGeneratorAction::setupCovariance() {
     // Convert the covarianceString to a set of Twiss parameters,
@@ -267,10 +275,35 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
             setupCovariance();
         }
         if (covarianceString != "" or Rcut != 0.0 or (beam_energy_min >= 0.0 and beam_energy_max > 0.0)) {
-            RNG = new TRandom1((UInt_t) rngSeed);
+            // May already be set when resuming from a checkpoint
+            if (RNG == NULL) {
+                RNG = new TRandom1((UInt_t) rngSeed);
+            }
         }
     }
 
+    if (recordRNGState) {
+        // Nothing has used the Geant4 RNG for this event yet
+        std::ostringstream rngState;
+        G4Random::saveFullState(rngState);
+        eventRNGState = rngState.str();
+    }
+
+    if (replay != NULL) {
+        // The recorded primary, and the Geant4 RNG state for the rest of the event
+        const replayEvent& ev = replay->Next();
+        x  = ev.x*mm;
+        xp = ev.xp*rad;
+        y  = ev.y*mm;
+        yp = ev.yp*rad;
+        E  = ev.E*MeV;
+        particleGun->SetParticlePosition(G4ThreeVector(x,y,beam_zpos));
+        particleGun->SetParticleMomentumDirection(G4ThreeVector(xp,yp,1));
+        particleGun->SetParticleEnergy(E);
+        particleGun->GeneratePrimaryVertex(anEvent);
+        return;
+    }
+
     if (hasCovariance) {
         int loopCounter = 0;
         while(true) {
@@ -340,5 +373,29 @@ void PrimaryGeneratorAction::GeneratePrimaries(G4Event* anEvent) {
         E = beam_energy*MeV;
     }
     particleGun->SetParticleEnergy(E); //Setting the kinetic energy (E>0 is valid)
+
+    if (kernel != NULL) {
+        // One vertex per particle leaving the target; the primary itself is not tracked
+        G4ParticleTable* particleTable = G4ParticleTable::GetParticleTable();
+        for (auto& sp : kernel->Sample(x, xp, y, yp, beam_zpos)) {
+            G4ParticleDefinition* kernelParticle = particleTable->FindParticle(sp.PDG);
+            if (kernelParticle == NULL) {
+                kernelParticle = G4IonTable::GetIonTable()->GetIon(sp.PDG);
+            }
+            if (kernelParticle == NULL) {
+                G4cerr << "Error in PrimaryGeneratorAction::GeneratePrimaries():" << G4endl
+                       << " Unknown particle PDG = " << sp.PDG << " in the kernel" << G4endl;
+                exit(1);
+            }
+            particleGun->SetParticleDefinition(kernelParticle);
+            particleGun->SetParticlePosition(sp.position);
+            particleGun->SetParticleMomentumDirection(sp.direction);
+            particleGun->SetParticleEnergy(sp.E);
+            particleGun->GeneratePrimaryVertex(anEvent);
+        }
+        particleGun->SetParticleDefinition(particle);
+        return;
+    }
+
     particleGun->GeneratePrimaryVertex(anEvent);
 }
@@ -0,0 +1,90 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RangeRejection.hh"
+#include "RunCounters.hh"
+
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4LogicalVolume.hh"
+#include "G4FieldManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4LossTableManager.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4ProcessManager.hh"
+#include "G4SystemOfUnits.hh"
+
+RangeRejection::RangeRejection(G4double Emax_arg, const G4String& processName) :
+    G4VDiscreteProcess(processName, fGeneral), Emax(Emax_arg*MeV) {
+    counters = RunCounters::Register("rangeRejection",
+                                     {"Stopped e-/e+ tracks", "Kinetic energy deposited locally [MeV]"});
+}
+
+G4double RangeRejection::PostStepGetPhysicalInteractionLength(const G4Track& track,
+                                                              G4double,
+                                                              G4ForceCondition* condition) {
+    *condition = NotForced;
+
+    const G4double Ekin = track.GetKineticEnergy();
+    if (Ekin <= 0.0 || Ekin > Emax) return DBL_MAX;
+
+    // Isotropic safety at the current position, as computed by the transportation
+    // at the end of the previous step; zero at the start of a track or on a boundary
+    const G4double safety = track.GetStep()->GetPreStepPoint()->GetSafety();
+    if (safety <= 0.0) return DBL_MAX;
+
+    // In a field, the track may curl around and leave the volume through
+    // a boundary further away than the safety, or deposit energy elsewhere
+    G4FieldManager* fieldMgr = track.GetVolume()->GetLogicalVolume()->GetFieldManager();
+    if (fieldMgr == NULL) {
+        fieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+    }
+    if (fieldMgr != NULL && fieldMgr->DoesFieldExist()) return DBL_MAX;
+
+    // Range from the energy loss tables of the current material,
+    // using the restricted dE/dx it is never shorter than the CSDA range
+    const G4double range = G4LossTableManager::Instance()->GetRange(track.GetDefinition(), Ekin,
+                                                                    track.GetMaterialCutsCouple());
+    if (range >= safety) return DBL_MAX;
+
+    return 0.0;
+}
+
+G4VParticleChange* RangeRejection::PostStepDoIt(const G4Track& track, const G4Step&) {
+    aParticleChange.Initialize(track);
+
+    const G4double Ekin = track.GetKineticEnergy();
+    aParticleChange.ProposeLocalEnergyDeposit(Ekin);
+    aParticleChange.ProposeEnergy(0.0);
+    if (track.GetDefinition() == G4Positron::Definition()) {
+        aParticleChange.ProposeTrackStatus(fStopButAlive);
+    }
+    else {
+        aParticleChange.ProposeTrackStatus(fStopAndKill);
+    }
+
+    counters->Add(0, 1.0);
+    counters->Add(1, Ekin/MeV);
+
+    return &aParticleChange;
+}
+
+void RangeRejectionPhysics::ConstructProcess() {
+    G4Electron::Definition()->GetProcessManager()->AddDiscreteProcess(new RangeRejection(Emax));
+    G4Positron::Definition()->GetProcessManager()->AddDiscreteProcess(new RangeRejection(Emax));
+}
@@ -21,8 +21,14 @@
 #include "TCanvas.h"
 #include "TTree.h"
 #include "TBranch.h"
+#include "TBasket.h"
+#include "TBuffer.h"
+#include "TLeaf.h"
+#include "TNamed.h"
 
 #include "TRandom1.h"
+#include "TObjString.h"
+#include "TMatrixD.h"
 
 #include "EdepHit.hh"
 #include "TrackerHit.hh"
@@ -31,16 +37,26 @@
 
 #include "G4Track.hh"
 #include "G4RunManager.hh"
+#include "Randomize.hh"
 
 #include "DetectorConstruction.hh"
 #include "MagnetClasses.hh"
 #include "VirtualTrackerWorldConstruction.hh"
 #include "PrimaryGeneratorAction.hh"
+#include "StackingAction.hh"
+#include "RunCounters.hh"
 
 #include "G4SystemOfUnits.hh"
 
 #include <iostream>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <set>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
 
 #include <unistd.h>
 
@@ -51,18 +67,23 @@ struct stat stat_info;
 
 using namespace std;
 RootFileWriter* RootFileWriter::singleton = NULL;
+volatile sig_atomic_t RootFileWriter::stopSignal = 0;
 
 const G4double RootFileWriter::phasespacehist_posLim = 10.0*mm;
 const G4double RootFileWriter::phasespacehist_angLim = 5.0*deg;
 
+const G4double phaseSpaceAccumulator::autoRange_quantile = 0.001;
+const G4double phaseSpaceAccumulator::autoRange_margin   = 0.25;
+
 void RootFileWriter::initializeRootFile(){
     G4RunManager*           run    = G4RunManager::GetRunManager();
     DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
     PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
     this->beamEnergy = genAct->get_beam_energy();
 
-    //Count all particles that are Fill'ed for the stats used to compute the twiss parameters,
+    //Count all particles that are Fill'ed in the histogram stats (mean, RMS etc.),
     // even if they are outside the phasespacehist_posLim / phaspacehist_angLim.
+    // The Twiss parameters are computed from the phaseSpaceAccumulator moments, which include all particles.
     TH2D::StatOverflows(true);
 
     if (not has_filename_out) {
@@ -166,26 +187,146 @@ void RootFileWriter::initializeRootFile(){
     }
     G4cout << G4endl;
 
+    // Histograms are owned and written explicitly by RootFileWriter, not by the TFile
+    TH1::AddDirectory(kFALSE);
+    writeManifest.clear();
+
     eventCounter = 0;
+    resumedEvents = 0;
+
+    for (auto& it : RunCounters::GetAll()) {
+        it.second.Reset();
+    }
+    if (planeScorer != NULL) {
+        planeScorer->SetCutoffs(beamEnergy*beamEnergy_cutoff, position_cutoffR);
+        planeScorer->Reset();
+    }
 
     // Limit for radial histograms
     G4double minR = min(detCon->getWorldSizeX(),detCon->getWorldSizeY())/mm;
 
     RNG = new TRandom1((UInt_t) rngSeed);
+    if (reservoirRNG != NULL) {
+        delete reservoirRNG;
+        reservoirRNG = NULL;
+    }
+    if (treeReservoir > 0) {
+        reservoirRNG = new TRandom1((UInt_t) rngSeed + 1);
+    }
+
+    runStartTime = std::chrono::steady_clock::now();
+    std::chrono::duration<double> startupDuration = runStartTime - startupTimeStart;
+    startupTime = startupDuration.count();
+    G4cout << "Startup (Geant4 initialization and physics tables) took " << startupTime << " [s]" << G4endl;
+    stopReason   = STOP_NONE;
+
+    checkpointFileName = foldername_out + "/" + filename_out + "_checkpoint.root";
+    lastCheckpointTime = runStartTime;
+
+    liveSnapshotFileName = foldername_out + "/" + filename_out + "_live.root";
+    lastLiveSnapshotTime = runStartTime;
+    if (liveSnapshotTime > 0.0) {
+        G4cout << "Writing live snapshots to '" << liveSnapshotFileName << "'" << G4endl;
+    }
+
+    lastProgressTime   = runStartTime;
+    lastProgressEvents = -1;
+    lastProgressHits.clear();
+    if (checkpointEvents > 0 or checkpointTime > 0.0 or resume) {
+        // A resumed run must give the same output as an uninterrupted one,
+        // so everything whose state is not in the checkpoint is rejected here.
+        if (treeReservoir > 0) {
+            G4cerr << "Error: Reservoir sampling of the TTrees is not compatible with checkpointing." << G4endl;
+            exit(1);
+        }
+        if (kernelWriter != NULL) {
+            G4cerr << "Error: --writeKernel is not compatible with checkpointing." << G4endl;
+            exit(1);
+        }
+        if (not miniFile and not statsOnly and chunkEvents == 0 and chunkSizeMB == 0.0) {
+            G4cerr << "Error: The TTrees are only kept across checkpoints when they are chunked;" << G4endl
+                   << " use --chunkEvents or --chunkSize, or --miniROOTfile, with checkpointing." << G4endl;
+            exit(1);
+        }
+    }
+    if (checkpointEvents > 0 or checkpointTime > 0.0) {
+        G4cout << "Writing checkpoints to '" << checkpointFileName << "'" << G4endl;
+    }
+
+    eventRNG = NULL;
+    if (recordRNG != "" and not statsOnly) {
+        // The Geant4 RNG state and primary particle for each recorded event, for --replay
+        if (recordRNG == "trigger" and not eventTrigger.IsActive()) {
+            G4cerr << "Error: --recordRNG trigger requires an event trigger (--trigger)." << G4endl;
+            exit(1);
+        }
+        eventRNG = new TTree("eventRNG", "Geant4 RNG state and primary particle at the start of each recorded event");
+        eventRNG->Branch("eventID",  &(eventRNGBuffer.eventID), "eventID/L");
+        eventRNG->Branch("rngState", &(eventRNGBuffer.rngState));
+        eventRNG->Branch("x",        &(eventRNGBuffer.x),       "x/D");
+        eventRNG->Branch("xp",       &(eventRNGBuffer.xp),      "xp/D");
+        eventRNG->Branch("y",        &(eventRNGBuffer.y),       "y/D");
+        eventRNG->Branch("yp",       &(eventRNGBuffer.yp),      "yp/D");
+        eventRNG->Branch("E",        &(eventRNGBuffer.E),       "E/D");
+        genAct->setRecordRNGState(true);
+        G4cout << "Recording the RNG state for " << (recordRNG == "all" ? "all events" : "events passing the trigger")
+               << " in the eventRNG TTree" << G4endl;
+    }
+
+    if (statsOnly) {
+        InitializeStatsOnly();
+        SetupEventTrigger();
+        ConnectPrecisionMonitor();
+        if (resume) {
+            ReadCheckpoint();
+        }
+        return;
+    }
 
     // TTrees for external analysis
     if (not miniFile) {
-        if (detCon->GetHasTarget()) {
-            targetExit = new TTree("TargetExit","TargetExit tree");
-            targetExit->Branch("TargetExitBranch", &targetExitBuffer,
-                               "x/D:y:z:px:py:pz:E:PDG/I:charge:eventID");
+        size_t numMagnets = detCon->magnets.size();
+        if (numMagnets > 0) {
+            magnetEdepsBuffer = new Double_t[numMagnets];
         }
 
-        trackerHits = new TTree("TrackerHits","TrackerHits tree");
-        trackerHits->Branch("TrackerHitsBranch", &trackerHitsBuffer,
-                            "x/D:y:z:px:py:pz:E:PDG/I:charge:eventID");
+        if (chunkEvents > 0 or chunkSizeMB > 0.0) {
+            // The TTrees are written to separate numbered files, with an index file
+            if (treeReservoir > 0) {
+                G4cerr << "Error: Reservoir sampling of the TTrees is not compatible with chunked TTree output." << G4endl;
+                exit(1);
+            }
+            chunkIndexFileName = foldername_out + "/" + filename_out + "_chunks.txt";
+            chunkIndex.clear();
+            chunkNumber = 0;
+            if (resume) {
+                // Continue after the last chunk that was closed when the checkpoint was written
+                ReadCheckpointChunkIndex();
+            }
+            OpenChunkFile();
+        }
+        else {
+            CreateHitTrees();
+        }
 
-        magnetEdeps = new TTree("magnetEdeps", "Magnet Edeps tree");
+        targetExitStaging.clear();
+        trackerHitsStaging.clear();
+        trackerHitsStaging.resize(VirtualTrackerWorldConstruction::getInstance()->getNumTrackers());
+
+        if (perEventTrees and treeReservoir > 0) {
+            G4cerr << "Error: Reservoir sampling of the TTrees is not compatible with perEventTrees." << G4endl;
+            exit(1);
+        }
+        treeFilter.Print();
+        hitTreeStats.clear();
+        hitTreeStats.push_back(hitTreePlaneStats());
+        hitTreeStats.back().name = "target";
+        G4int numTrackers = VirtualTrackerWorldConstruction::getInstance()->getNumTrackers();
+        for (int idx = 0; idx < numTrackers; idx++) {
+            hitTreeStats.push_back(hitTreePlaneStats());
+            if (numTrackers == 1) { hitTreeStats.back().name = "tracker"; }
+            else                  { hitTreeStats.back().name = std::string("tracker_") + std::to_string(idx+1); }
+        }
     }
 
     // Target energy deposition
@@ -278,33 +419,29 @@ void RootFileWriter::initializeRootFile(){
 						   5001, -90, 90);
 
         // Target exit phasespace histograms
-        target_exit_phasespaceX         = new TH2D("target_exit_x",
+        target_exit_phasespaceX         = NewPhaseSpace("target_exit_x",
 						   "Target exit phase space (x)",
 						   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
 						   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        target_exit_phasespaceX->GetXaxis()->SetTitle("Position x [mm]");
-        target_exit_phasespaceX->GetYaxis()->SetTitle("Angle dx/dz [rad]");
+        target_exit_phasespaceX->SetAxisTitles("Position x [mm]", "Angle dx/dz [rad]");
 
-        target_exit_phasespaceY         = new TH2D("target_exit_y",
+        target_exit_phasespaceY         = NewPhaseSpace("target_exit_y",
 						   "Target exit phase space (y)",
 						   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
 						   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        target_exit_phasespaceY->GetXaxis()->SetTitle("Position y [mm]");
-        target_exit_phasespaceY->GetYaxis()->SetTitle("Angle dy/dz [rad]");
+        target_exit_phasespaceY->SetAxisTitles("Position y [mm]", "Angle dy/dz [rad]");
 
-        target_exit_phasespaceX_cutoff  = new TH2D("target_exit_cutoff_x",
+        target_exit_phasespaceX_cutoff  = NewPhaseSpace("target_exit_cutoff_x",
 						   "Target exit phase space (x) (charged, energy > Ecut, r < Rcut)",
 						   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
 						   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        target_exit_phasespaceX_cutoff->GetXaxis()->SetTitle("Position x [mm]");
-        target_exit_phasespaceX_cutoff->GetYaxis()->SetTitle("Angle dx/dz [rad]");
+        target_exit_phasespaceX_cutoff->SetAxisTitles("Position x [mm]", "Angle dx/dz [rad]");
 
-        target_exit_phasespaceY_cutoff  = new TH2D("target_exit_cutoff_y",
+        target_exit_phasespaceY_cutoff  = NewPhaseSpace("target_exit_cutoff_y",
 						   "Target exit phase space (y) (charged, energy > Ecut, r < Rcut)",
 						   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
 						   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        target_exit_phasespaceY_cutoff->GetXaxis()->SetTitle("Position y [mm]");
-        target_exit_phasespaceY_cutoff->GetYaxis()->SetTitle("Angle dy/dz [rad]");
+        target_exit_phasespaceY_cutoff->SetAxisTitles("Position y [mm]", "Angle dy/dz [rad]");
 
 	target_exit_phasespaceXY        = new TH2D("target_exit_xy",
 						   "Target exit phase space (x,y)",
@@ -379,20 +516,18 @@ void RootFileWriter::initializeRootFile(){
         }
 
         tracker_phasespaceX.push_back(
-            new TH2D((trackerName+"_x").c_str(),
+            NewPhaseSpace((trackerName+"_x").c_str(),
                      (trackerName+" phase space (x)").c_str(),
                      1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                      1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad) );
-        tracker_phasespaceX.back()->GetXaxis()->SetTitle("X [mm]");
-        tracker_phasespaceX.back()->GetYaxis()->SetTitle("X' [rad]");
+        tracker_phasespaceX.back()->SetAxisTitles("X [mm]", "X' [rad]");
 
         tracker_phasespaceY.push_back(
-            new TH2D((trackerName+"_y").c_str(),
+            NewPhaseSpace((trackerName+"_y").c_str(),
                      (trackerName+" phase space (y)").c_str(),
                     1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                     1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad) );
-        tracker_phasespaceY.back()->GetXaxis()->SetTitle("Y [mm]");
-        tracker_phasespaceY.back()->GetYaxis()->SetTitle("Y' [rad]");
+        tracker_phasespaceY.back()->SetAxisTitles("Y [mm]", "Y' [rad]");
 
         tracker_phasespaceXY.push_back(
             new TH2D((trackerName+"_xy").c_str(),
@@ -403,20 +538,18 @@ void RootFileWriter::initializeRootFile(){
         tracker_phasespaceXY.back()->GetYaxis()->SetTitle("Y [mm]");
 
         tracker_phasespaceX_cutoff.push_back(
-            new TH2D((trackerName+"_cutoff_x").c_str(),
+            NewPhaseSpace((trackerName+"_cutoff_x").c_str(),
                      (trackerName+" phase space (x) (charged, energy > Ecut, r < Rcut)").c_str(),
                      1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                      1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad) );
-        tracker_phasespaceX_cutoff.back()->GetXaxis()->SetTitle("X [mm]");
-        tracker_phasespaceX_cutoff.back()->GetYaxis()->SetTitle("X' [rad]");
+        tracker_phasespaceX_cutoff.back()->SetAxisTitles("X [mm]", "X' [rad]");
         
         tracker_phasespaceY_cutoff.push_back(
-            new TH2D((trackerName+"_cutoff_y").c_str(),
+            NewPhaseSpace((trackerName+"_cutoff_y").c_str(),
                      (trackerName+" phase space (y) (charged, energy > Ecut, r < Rcut)").c_str(),
                      1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                      1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad) );
-        tracker_phasespaceY_cutoff.back()->GetXaxis()->SetTitle("Y [mm]");
-        tracker_phasespaceY_cutoff.back()->GetYaxis()->SetTitle("Y' [rad]");
+        tracker_phasespaceY_cutoff.back()->SetAxisTitles("Y [mm]", "Y' [rad]");
 
 	tracker_phasespaceXY_cutoff.push_back(
             new TH2D((trackerName+"_cutoff_xy").c_str(),
@@ -426,56 +559,54 @@ void RootFileWriter::initializeRootFile(){
         tracker_phasespaceXY_cutoff.back()->GetXaxis()->SetTitle("X [mm]");
         tracker_phasespaceXY_cutoff.back()->GetYaxis()->SetTitle("Y [mm]");
 	
-        tracker_phasespaceX_cutoff_PDG.push_back(std::map<G4int,TH2D*>());
-        tracker_phasespaceY_cutoff_PDG.push_back(std::map<G4int,TH2D*>());
-        tracker_phasespaceX_cutoff_PDG.back()[11]  = new TH2D((trackerName+"_cutoff_x_PDG11").c_str(),
+        tracker_phasespaceX_cutoff_PDG.push_back(std::map<G4int,phaseSpaceAccumulator*>());
+        tracker_phasespaceY_cutoff_PDG.push_back(std::map<G4int,phaseSpaceAccumulator*>());
+        tracker_phasespaceX_cutoff_PDG.back()[11]  = NewPhaseSpace((trackerName+"_cutoff_x_PDG11").c_str(),
                                                                   (trackerName+" phase space (x) (electrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceX_cutoff_PDG.back()[-11]  = new TH2D((trackerName+"_cutoff_x_PDG-11").c_str(),
+        tracker_phasespaceX_cutoff_PDG.back()[-11]  = NewPhaseSpace((trackerName+"_cutoff_x_PDG-11").c_str(),
                                                                   (trackerName+" phase space (x) (positrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceX_cutoff_PDG.back()[22]  = new TH2D((trackerName+"_cutoff_x_PDG22").c_str(),
+        tracker_phasespaceX_cutoff_PDG.back()[22]  = NewPhaseSpace((trackerName+"_cutoff_x_PDG22").c_str(),
                                                                   (trackerName+" phase space (x) (photons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceX_cutoff_PDG.back()[2212]  = new TH2D((trackerName+"_cutoff_x_PDG2212").c_str(),
+        tracker_phasespaceX_cutoff_PDG.back()[2212]  = NewPhaseSpace((trackerName+"_cutoff_x_PDG2212").c_str(),
                                                                   (trackerName+" phase space (x) (protons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceX_cutoff_PDG.back()[0]  = new TH2D((trackerName+"_cutoff_x_PDGother").c_str(),
+        tracker_phasespaceX_cutoff_PDG.back()[0]  = NewPhaseSpace((trackerName+"_cutoff_x_PDGother").c_str(),
                                                                   (trackerName+" phase space (x) (other, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
         for (auto PDG : tracker_phasespaceX_cutoff_PDG.back()) {
-            PDG.second->GetXaxis()->SetTitle("X [mm]");
-            PDG.second->GetYaxis()->SetTitle("X' [rad]");
+            PDG.second->SetAxisTitles("X [mm]", "X' [rad]");
         }
 	
-        tracker_phasespaceY_cutoff_PDG.back()[11]  = new TH2D((trackerName+"_cutoff_y_PDG11").c_str(),
+        tracker_phasespaceY_cutoff_PDG.back()[11]  = NewPhaseSpace((trackerName+"_cutoff_y_PDG11").c_str(),
                                                                   (trackerName+" phase space (y) (electrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceY_cutoff_PDG.back()[-11]  = new TH2D((trackerName+"_cutoff_y_PDG-11").c_str(),
+        tracker_phasespaceY_cutoff_PDG.back()[-11]  = NewPhaseSpace((trackerName+"_cutoff_y_PDG-11").c_str(),
                                                                   (trackerName+" phase space (y) (positrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceY_cutoff_PDG.back()[22]  = new TH2D((trackerName+"_cutoff_y_PDG22").c_str(),
+        tracker_phasespaceY_cutoff_PDG.back()[22]  = NewPhaseSpace((trackerName+"_cutoff_y_PDG22").c_str(),
                                                                   (trackerName+" phase space (y) (photons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceY_cutoff_PDG.back()[2212]  = new TH2D((trackerName+"_cutoff_y_PDG2212").c_str(),
+        tracker_phasespaceY_cutoff_PDG.back()[2212]  = NewPhaseSpace((trackerName+"_cutoff_y_PDG2212").c_str(),
                                                                   (trackerName+" phase space (y) (protons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        tracker_phasespaceY_cutoff_PDG.back()[0]  = new TH2D((trackerName+"_cutoff_y_PDGother").c_str(),
+        tracker_phasespaceY_cutoff_PDG.back()[0]  = NewPhaseSpace((trackerName+"_cutoff_y_PDGother").c_str(),
                                                                   (trackerName+" phase space (y) (other, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
         for (auto PDG : tracker_phasespaceY_cutoff_PDG.back()) {
-            PDG.second->GetXaxis()->SetTitle("Y [mm]");
-            PDG.second->GetYaxis()->SetTitle("Y' [rad]");
+            PDG.second->SetAxisTitles("Y [mm]", "Y' [rad]");
         }
 
 	tracker_phasespaceXY_cutoff_PDG.push_back(std::map<G4int,TH2D*>());
@@ -547,21 +678,17 @@ void RootFileWriter::initializeRootFile(){
     }
 
     init_phasespaceX   =
-        new TH2D("init_x",
+        NewPhaseSpace("init_x",
                  "Initial phase space (x)",
                  1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                  1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //init_phasespaceX->Sumw2();
-    init_phasespaceX->GetXaxis()->SetTitle("X [mm]");
-    init_phasespaceX->GetYaxis()->SetTitle("X' [rad]");
+    init_phasespaceX->SetAxisTitles("X [mm]", "X' [rad]");
     init_phasespaceY   =
-        new TH2D("init_y",
+        NewPhaseSpace("init_y",
                  "Initial phase space (y)",
                  1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                  1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-    //init_phasespaceY->Sumw2();
-    init_phasespaceY->GetXaxis()->SetTitle("Y [mm]");
-    init_phasespaceY->GetYaxis()->SetTitle("Y' [rad]");
+    init_phasespaceY->SetAxisTitles("Y [mm]", "Y' [rad]");
     init_phasespaceXY   =
         new TH2D("init_xy",
                  "Initial phase space (x,y)",
@@ -714,93 +841,87 @@ void RootFileWriter::initializeRootFile(){
         }
 
         magnet_exit_phasespaceX.push_back
-            ( new TH2D((magName+"_x").c_str(),
+            ( NewPhaseSpace((magName+"_x").c_str(),
                        (magName+" phase space (x)").c_str(),
                        1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                        1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad)
               );
-        magnet_exit_phasespaceX.back()->GetXaxis()->SetTitle("X [mm]");
-        magnet_exit_phasespaceX.back()->GetYaxis()->SetTitle("X' [rad]");
+        magnet_exit_phasespaceX.back()->SetAxisTitles("X [mm]", "X' [rad]");
 
         magnet_exit_phasespaceY.push_back
-            ( new TH2D((magName+"_y").c_str(),
+            ( NewPhaseSpace((magName+"_y").c_str(),
                        (magName+" phase space (y)").c_str(),
                        1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                        1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad)
               );
-        magnet_exit_phasespaceY.back()->GetXaxis()->SetTitle("Y [mm]");
-        magnet_exit_phasespaceY.back()->GetYaxis()->SetTitle("Y' [rad]");
+        magnet_exit_phasespaceY.back()->SetAxisTitles("Y [mm]", "Y' [rad]");
 
         magnet_exit_phasespaceX_cutoff.push_back
-            ( new TH2D((magName+"_cutoff_x").c_str(),
+            ( NewPhaseSpace((magName+"_cutoff_x").c_str(),
                        (magName+" phase space (x) (charged, energy > Ecut, r < Rcut)").c_str(),
                        1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                        1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad)
               );
-        magnet_exit_phasespaceX_cutoff.back()->GetXaxis()->SetTitle("X [mm]");
-        magnet_exit_phasespaceX_cutoff.back()->GetYaxis()->SetTitle("X' [rad]");
+        magnet_exit_phasespaceX_cutoff.back()->SetAxisTitles("X [mm]", "X' [rad]");
 
         magnet_exit_phasespaceY_cutoff.push_back
-            ( new TH2D((magName+"_cutoff_y").c_str(),
+            ( NewPhaseSpace((magName+"_cutoff_y").c_str(),
                        (magName+" phase space (y) (charged, energy > Ecut, r < Rcut)").c_str(),
                        1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                        1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad)
               );
-        magnet_exit_phasespaceY_cutoff.back()->GetXaxis()->SetTitle("Y [mm]");
-        magnet_exit_phasespaceY_cutoff.back()->GetYaxis()->SetTitle("Y' [rad]");
+        magnet_exit_phasespaceY_cutoff.back()->SetAxisTitles("Y [mm]", "Y' [rad]");
 
-        magnet_exit_phasespaceX_cutoff_PDG.push_back(std::map<G4int,TH2D*>());
-        magnet_exit_phasespaceY_cutoff_PDG.push_back(std::map<G4int,TH2D*>());
+        magnet_exit_phasespaceX_cutoff_PDG.push_back(std::map<G4int,phaseSpaceAccumulator*>());
+        magnet_exit_phasespaceY_cutoff_PDG.push_back(std::map<G4int,phaseSpaceAccumulator*>());
 
-        magnet_exit_phasespaceX_cutoff_PDG.back()[11]  = new TH2D((magName+"_cutoff_x_PDG11").c_str(),
+        magnet_exit_phasespaceX_cutoff_PDG.back()[11]  = NewPhaseSpace((magName+"_cutoff_x_PDG11").c_str(),
                                                                   (magName+" phase space (x) (electrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceX_cutoff_PDG.back()[-11]  = new TH2D((magName+"_cutoff_x_PDG-11").c_str(),
+        magnet_exit_phasespaceX_cutoff_PDG.back()[-11]  = NewPhaseSpace((magName+"_cutoff_x_PDG-11").c_str(),
                                                                   (magName+" phase space (x) (positrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceX_cutoff_PDG.back()[22]  = new TH2D((magName+"_cutoff_x_PDG22").c_str(),
+        magnet_exit_phasespaceX_cutoff_PDG.back()[22]  = NewPhaseSpace((magName+"_cutoff_x_PDG22").c_str(),
                                                                   (magName+" phase space (x) (photons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceX_cutoff_PDG.back()[2212]  = new TH2D((magName+"_cutoff_x_PDG2212").c_str(),
+        magnet_exit_phasespaceX_cutoff_PDG.back()[2212]  = NewPhaseSpace((magName+"_cutoff_x_PDG2212").c_str(),
                                                                   (magName+" phase space (x) (protons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceX_cutoff_PDG.back()[0]  = new TH2D((magName+"_cutoff_x_PDGother").c_str(),
+        magnet_exit_phasespaceX_cutoff_PDG.back()[0]  = NewPhaseSpace((magName+"_cutoff_x_PDGother").c_str(),
                                                                   (magName+" phase space (x) (other, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
         for (auto PDG : magnet_exit_phasespaceX_cutoff_PDG.back()) {
-            PDG.second->GetXaxis()->SetTitle("X [mm]");
-            PDG.second->GetYaxis()->SetTitle("X' [rad]");
+            PDG.second->SetAxisTitles("X [mm]", "X' [rad]");
         }
 
 
-        magnet_exit_phasespaceY_cutoff_PDG.back()[11]  = new TH2D((magName+"_cutoff_y_PDG11").c_str(),
+        magnet_exit_phasespaceY_cutoff_PDG.back()[11]  = NewPhaseSpace((magName+"_cutoff_y_PDG11").c_str(),
                                                                   (magName+" phase space (y) (electrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceY_cutoff_PDG.back()[-11]  = new TH2D((magName+"_cutoff_y_PDG-11").c_str(),
+        magnet_exit_phasespaceY_cutoff_PDG.back()[-11]  = NewPhaseSpace((magName+"_cutoff_y_PDG-11").c_str(),
                                                                   (magName+" phase space (y) (positrons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceY_cutoff_PDG.back()[22]  = new TH2D((magName+"_cutoff_y_PDG22").c_str(),
+        magnet_exit_phasespaceY_cutoff_PDG.back()[22]  = NewPhaseSpace((magName+"_cutoff_y_PDG22").c_str(),
                                                                   (magName+" phase space (y) (photons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceY_cutoff_PDG.back()[2212]  = new TH2D((magName+"_cutoff_y_PDG2212").c_str(),
+        magnet_exit_phasespaceY_cutoff_PDG.back()[2212]  = NewPhaseSpace((magName+"_cutoff_y_PDG2212").c_str(),
                                                                   (magName+" phase space (y) (protons, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
-        magnet_exit_phasespaceY_cutoff_PDG.back()[0]  = new TH2D((magName+"_cutoff_y_PDGother").c_str(),
+        magnet_exit_phasespaceY_cutoff_PDG.back()[0]  = NewPhaseSpace((magName+"_cutoff_y_PDGother").c_str(),
                                                                   (magName+" phase space (y) (other, energy > Ecut, r < Rcut)").c_str(),
                                                                   1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
                                                                   1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
         for (auto PDG : magnet_exit_phasespaceY_cutoff_PDG.back()) {
-            PDG.second->GetXaxis()->SetTitle("Y [mm]");
-            PDG.second->GetYaxis()->SetTitle("Y' [rad]");
+            PDG.second->SetAxisTitles("Y [mm]", "Y' [rad]");
         }
 
         typeCounter[magName]             = particleTypesCounter();
@@ -847,17 +968,12 @@ void RootFileWriter::initializeRootFile(){
         }
     }
 
-    if (not miniFile) {
-        size_t numMagnets = detCon->magnets.size();
-        if (numMagnets > 0) {
-            magnetEdepsBuffer = new Double_t[numMagnets];
-            size_t i = 0;
-            for (auto mag : detCon->magnets) {
-                G4String magName = mag->magnetName;
-                magnetEdeps->Branch(magName, &(magnetEdepsBuffer[i]), (magName+"/D").c_str());
-                i++;
-            }
-        }
+    SetupEventTrigger();
+
+    ConnectPrecisionMonitor();
+
+    if (resume) {
+        ReadCheckpoint();
     }
 }
 
@@ -869,6 +985,18 @@ void RootFileWriter::doEvent(const G4Event* event){
 
     eventCounter++;
 
+    if (kernelWriter != NULL) {
+        G4int TargetExitpos_CollID = G4SDManager::GetSDMpointer()->GetCollectionID("target_exitpos");
+        TrackerHitsCollection* targetExitposHitsCollection = (TargetExitpos_CollID >= 0) ?
+            (TrackerHitsCollection*) (event->GetHCofThisEvent()->GetHC(TargetExitpos_CollID)) : NULL;
+        kernelWriter->AddEvent(targetExitposHitsCollection,
+                               genAct->x, genAct->xp, genAct->y, genAct->yp, genAct->get_beam_zpos());
+    }
+
+    if (eventTrigger.IsActive()) {
+        eventTrigger.Reset();
+    }
+
     G4HCofThisEvent* HCE=event->GetHCofThisEvent();
     G4SDManager* SDman = G4SDManager::GetSDMpointer();
 
@@ -911,9 +1039,19 @@ void RootFileWriter::doEvent(const G4Event* event){
                     }
                 }
 
-                targetEdep->Fill(edep/MeV);
-                targetEdep_NIEL->Fill(edep_NIEL/keV);
-                targetEdep_IEL->Fill(edep_IEL/MeV);
+                if (statsOnly) {
+                    target_edep_sum  += edep/MeV;
+                    target_edep_sum2 += (edep/MeV)*(edep/MeV);
+                }
+                else {
+                    targetEdep->Fill(edep/MeV);
+                    targetEdep_NIEL->Fill(edep_NIEL/keV);
+                    targetEdep_IEL->Fill(edep_IEL/MeV);
+                }
+
+                if (eventTrigger.IsActive()) {
+                    eventTrigger.AddEdep(triggerIdx_target, edep/MeV);
+                }
             }
             else {
                 G4cout << "targetEdepHitsCollection was NULL!"<<G4endl;
@@ -941,6 +1079,10 @@ void RootFileWriter::doEvent(const G4Event* event){
                     const G4int          PDG         = (*targetExitposHitsCollection)[i]->GetPDG();
                     const G4String&      type        = (*targetExitposHitsCollection)[i]->GetType();
 
+                    if (eventTrigger.IsActive()) {
+                        eventTrigger.AddHit(triggerIdx_target, energy/MeV, hitR/mm);
+                    }
+
                     //Particle type counting
                     FillParticleTypes(typeCounter["target"], PDG, type);
                     if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
@@ -948,11 +1090,6 @@ void RootFileWriter::doEvent(const G4Event* event){
                     }
 
                     //Exit angle
-                    target_exitangle_hist->Fill(exitangle);
-                    if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
-                        target_exitangle_hist_cutoff->Fill(exitangle);
-                    }
-
                     target_exitangle              += exitangle;
                     target_exitangle2             += exitangle*exitangle;
                     target_exitangle_numparticles += 1;
@@ -966,65 +1103,77 @@ void RootFileWriter::doEvent(const G4Event* event){
                     //Phase space
                     target_exit_phasespaceX->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
                     target_exit_phasespaceY->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-		    target_exit_phasespaceXY->Fill(hitPos.x()/mm,hitPos.y()/mm);
 
                     if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
                         target_exit_phasespaceX_cutoff->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
                         target_exit_phasespaceY_cutoff->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-			target_exit_phasespaceXY_cutoff->Fill(hitPos.x()/mm,hitPos.y()/mm);
                     }
 
-                    //Energy
-                    if (target_exit_energy.find(PDG) != target_exit_energy.end()) {
-                        target_exit_energy[PDG]->Fill(energy/MeV);
-                    }
-                    else {
-                        target_exit_energy[0]->Fill(energy/MeV);
-                    }
+                    // Histograms (none in statsOnly mode)
+                    if (not statsOnly) {
+                        target_exitangle_hist->Fill(exitangle);
+                        if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+                            target_exitangle_hist_cutoff->Fill(exitangle);
+                        }
+
+                        target_exit_phasespaceXY->Fill(hitPos.x()/mm,hitPos.y()/mm);
+                        if (charge != 0 and energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+                            target_exit_phasespaceXY_cutoff->Fill(hitPos.x()/mm,hitPos.y()/mm);
+                        }
 
-                    if (hitR/mm < position_cutoffR and energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                        if (target_exit_cutoff_energy.find(PDG) != target_exit_cutoff_energy.end()) {
-                            target_exit_cutoff_energy[PDG]->Fill(energy/MeV);
+                        //Energy
+                        if (target_exit_energy.find(PDG) != target_exit_energy.end()) {
+                            target_exit_energy[PDG]->Fill(energy/MeV);
                         }
                         else {
-                            target_exit_cutoff_energy[0]->Fill(energy/MeV);
+                            target_exit_energy[0]->Fill(energy/MeV);
                         }
-                    }
 
-                    //R position
-                    if (target_exit_Rpos.find(PDG) != target_exit_Rpos.end()) {
-                        target_exit_Rpos[PDG]->Fill(hitR/mm);
-                    }
-                    else {
-                        target_exit_Rpos[0]->Fill(hitR/mm);
-                    }
-                    if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                        if (target_exit_Rpos_cutoff.find(PDG) != target_exit_Rpos_cutoff.end()) {
-                            target_exit_Rpos_cutoff[PDG]->Fill(hitR/mm);
+                        if (hitR/mm < position_cutoffR and energy/MeV > beamEnergy*beamEnergy_cutoff) {
+                            if (target_exit_cutoff_energy.find(PDG) != target_exit_cutoff_energy.end()) {
+                                target_exit_cutoff_energy[PDG]->Fill(energy/MeV);
+                            }
+                            else {
+                                target_exit_cutoff_energy[0]->Fill(energy/MeV);
+                            }
+                        }
+
+                        //R position
+                        if (target_exit_Rpos.find(PDG) != target_exit_Rpos.end()) {
+                            target_exit_Rpos[PDG]->Fill(hitR/mm);
                         }
                         else {
-                            target_exit_Rpos_cutoff[0]->Fill(hitR/mm);
+                            target_exit_Rpos[0]->Fill(hitR/mm);
+                        }
+                        if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
+                            if (target_exit_Rpos_cutoff.find(PDG) != target_exit_Rpos_cutoff.end()) {
+                                target_exit_Rpos_cutoff[PDG]->Fill(hitR/mm);
+                            }
+                            else {
+                                target_exit_Rpos_cutoff[0]->Fill(hitR/mm);
+                            }
                         }
                     }
 
-                    //Fill the TTree
+                    //Stage the hit for the TTree, filled at the end of the event
                     if (not miniFile) {
-                        targetExitBuffer.x = hitPos.x()/mm;
-                        targetExitBuffer.y = hitPos.x()/mm;
-                        targetExitBuffer.z = hitPos.z()/mm;
+                        trackerHitStruct hit;
+                        hit.x = hitPos.x()/mm;
+                        hit.y = hitPos.y()/mm;
+                        hit.z = hitPos.z()/mm;
 
-                        targetExitBuffer.px = momentum.x()/MeV;
-                        targetExitBuffer.py = momentum.y()/MeV;
-                        targetExitBuffer.pz = momentum.z()/MeV;
+                        hit.px = momentum.x()/MeV;
+                        hit.py = momentum.y()/MeV;
+                        hit.pz = momentum.z()/MeV;
 
-                        targetExitBuffer.E = energy / MeV;
+                        hit.E = energy / MeV;
 
-                        targetExitBuffer.PDG = PDG;
-                        targetExitBuffer.charge = charge;
+                        hit.PDG = PDG;
+                        hit.charge = charge;
 
-                        targetExitBuffer.eventID = eventCounter;
+                        hit.eventID = GetEventID();
 
-                        targetExit->Fill();
+                        targetExitStaging.push_back(hit);
                     }
                 }
 
@@ -1064,36 +1213,53 @@ void RootFileWriter::doEvent(const G4Event* event){
                     const G4ThreeVector& momentum = (*trackerHitsCollection)[i]->GetMomentum();
                     const G4double       hitR     = sqrt(hitPos.x()*hitPos.x() + hitPos.y()*hitPos.y());
 
-                    //Overall histograms
-                    tracker_energy[idx]->Fill(energy/MeV);
-
-                    if (tracker_type_energy[idx].find(PDG) != tracker_type_energy[idx].end()) {
-                        tracker_type_energy[idx][PDG]->Fill(energy/MeV);
-                    }
-                    else {
-                        tracker_type_energy[idx][0]->Fill(energy/MeV);
+                    if (eventTrigger.IsActive()) {
+                        eventTrigger.AddHit(triggerIdx_trackers[idx], energy/MeV, hitR/mm);
                     }
 
-                    if (hitR/mm < position_cutoffR) {
-                        if (tracker_type_cutoff_energy[idx].find(PDG) != tracker_type_cutoff_energy[idx].end()) {
-                            tracker_type_cutoff_energy[idx][PDG]->Fill(energy/MeV);
+                    //Overall histograms
+                    if (not statsOnly) {
+                        tracker_energy[idx]->Fill(energy/MeV);
+
+                        if (tracker_type_energy[idx].find(PDG) != tracker_type_energy[idx].end()) {
+                            tracker_type_energy[idx][PDG]->Fill(energy/MeV);
                         }
                         else {
-                            tracker_type_cutoff_energy[idx][0]->Fill(energy/MeV);
+                            tracker_type_energy[idx][0]->Fill(energy/MeV);
+                        }
+
+                        if (hitR/mm < position_cutoffR) {
+                            if (tracker_type_cutoff_energy[idx].find(PDG) != tracker_type_cutoff_energy[idx].end()) {
+                                tracker_type_cutoff_energy[idx][PDG]->Fill(energy/MeV);
+                            }
+                            else {
+                                tracker_type_cutoff_energy[idx][0]->Fill(energy/MeV);
+                            }
+                        }
+
+                        tracker_phasespaceXY[idx]->Fill(hitPos.x()/mm, hitPos.y()/mm);
+                        if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
+                            if (charge != 0) {
+                                tracker_phasespaceXY_cutoff[idx]->Fill(hitPos.x()/mm, hitPos.y()/mm);
+                            }
+                            if(tracker_phasespaceXY_cutoff_PDG[idx].find(PDG) != tracker_phasespaceXY_cutoff_PDG[idx].end()) {
+                                tracker_phasespaceXY_cutoff_PDG[idx][PDG]->Fill(hitPos.x()/mm, momentum.y()/mm);
+                            }
+                            else {
+                                tracker_phasespaceXY_cutoff_PDG[idx][0]->Fill(hitPos.x()/mm, momentum.y()/mm);
+                            }
                         }
                     }
 
                     //Phase space
                     tracker_phasespaceX[idx]->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
                     tracker_phasespaceY[idx]->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-		    tracker_phasespaceXY[idx]->Fill(hitPos.x()/mm, hitPos.y()/mm);
 
                     if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
                         if (charge != 0) {
                             // All charged particles passing the cutoff
                             tracker_phasespaceX_cutoff[idx]->Fill(hitPos.x()/mm, momentum.x()/momentum.z());
                             tracker_phasespaceY_cutoff[idx]->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
-			    tracker_phasespaceXY_cutoff[idx]->Fill(hitPos.x()/mm, hitPos.y()/mm);
                         }
 
                         //Also separated by species
@@ -1110,13 +1276,6 @@ void RootFileWriter::doEvent(const G4Event* event){
                         else {
                             tracker_phasespaceY_cutoff_PDG[idx][0]->Fill(hitPos.y()/mm, momentum.y()/momentum.z());
                         }
-
-			if(tracker_phasespaceXY_cutoff_PDG[idx].find(PDG) != tracker_phasespaceXY_cutoff_PDG[idx].end()) {
-                            tracker_phasespaceXY_cutoff_PDG[idx][PDG]->Fill(hitPos.x()/mm, momentum.y()/mm);
-                        }
-                        else {
-                            tracker_phasespaceXY_cutoff_PDG[idx][0]->Fill(hitPos.x()/mm, momentum.y()/mm);
-                        }
                     }
 
                     //Particle type counting
@@ -1126,43 +1285,48 @@ void RootFileWriter::doEvent(const G4Event* event){
                     }
 
                     //R position
-                    if (tracker_Rpos[idx].find(PDG) != tracker_Rpos[idx].end()) {
-                        tracker_Rpos[idx][PDG]->Fill(hitR/mm);
-                    }
-                    else {
-                        tracker_Rpos[idx][0]->Fill(hitR/mm);
-                    }
-                    if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                        if (tracker_Rpos_cutoff[idx].find(PDG) != tracker_Rpos_cutoff[idx].end()) {
-                            tracker_Rpos_cutoff[idx][PDG]->Fill(hitR/mm);
+                    if (not statsOnly) {
+                        if (tracker_Rpos[idx].find(PDG) != tracker_Rpos[idx].end()) {
+                            tracker_Rpos[idx][PDG]->Fill(hitR/mm);
                         }
                         else {
-                            tracker_Rpos_cutoff[idx][0]->Fill(hitR/mm);
+                            tracker_Rpos[idx][0]->Fill(hitR/mm);
+                        }
+                        if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
+                            if (tracker_Rpos_cutoff[idx].find(PDG) != tracker_Rpos_cutoff[idx].end()) {
+                                tracker_Rpos_cutoff[idx][PDG]->Fill(hitR/mm);
+                            }
+                            else {
+                                tracker_Rpos_cutoff[idx][0]->Fill(hitR/mm);
+                            }
                         }
                     }
 
-                    //Fill the TTree
+                    //Stage the hit for the TTree, filled at the end of the event
                     if (not miniFile) {
-                        trackerHitsBuffer.x = hitPos.x()/mm;
-                        trackerHitsBuffer.y = hitPos.x()/mm;
-                        trackerHitsBuffer.z = hitPos.z()/mm;
+                        trackerHitStruct hit;
+                        hit.x = hitPos.x()/mm;
+                        hit.y = hitPos.y()/mm;
+                        hit.z = hitPos.z()/mm;
 
-                        trackerHitsBuffer.px = momentum.x()/MeV;
-                        trackerHitsBuffer.py = momentum.y()/MeV;
-                        trackerHitsBuffer.pz = momentum.z()/MeV;
+                        hit.px = momentum.x()/MeV;
+                        hit.py = momentum.y()/MeV;
+                        hit.pz = momentum.z()/MeV;
 
-                        trackerHitsBuffer.E = energy / MeV;
+                        hit.E = energy / MeV;
 
-                        trackerHitsBuffer.PDG = PDG;
-                        trackerHitsBuffer.charge = charge;
+                        hit.PDG = PDG;
+                        hit.charge = charge;
 
-                        trackerHitsBuffer.eventID = eventCounter;
+                        hit.eventID = GetEventID();
 
-                        trackerHits->Fill();
+                        trackerHitsStaging[idx].push_back(hit);
                     }
                 }
 
-                tracker_numParticles[idx]->Fill(nEntries);
+                if (not statsOnly) {
+                    tracker_numParticles[idx]->Fill(nEntries);
+                }
             }
             else{
                 G4cout << "trackerHitsCollection was NULL! for tracker '" + trackerName << "'" << G4endl;
@@ -1176,8 +1340,10 @@ void RootFileWriter::doEvent(const G4Event* event){
     // Initial particle distribution
     init_phasespaceX->Fill(genAct->x/mm,genAct->xp/rad);
     init_phasespaceY->Fill(genAct->y/mm,genAct->yp/rad);
-    init_phasespaceXY->Fill(genAct->x/mm,genAct->y/mm);
-    init_E->Fill(genAct->E/MeV);
+    if (not statsOnly) {
+        init_phasespaceXY->Fill(genAct->x/mm,genAct->y/mm);
+        init_E->Fill(genAct->E/MeV);
+    }
 
     // *** Data from Magnets, which use a TargetSD ***
     size_t magIdx = -1;
@@ -1200,7 +1366,7 @@ void RootFileWriter::doEvent(const G4Event* event){
                     edep      += edepHit->GetDepositedEnergy();
 
                     //Randomly spread the energy deposits over the step
-                    if (magnet_edep_rdens[magIdx] != NULL) {
+                    if (not statsOnly and magnet_edep_rdens[magIdx] != NULL) {
                         G4ThreeVector edepStep = edepHit->GetPostStepPoint() - edepHit->GetPreStepPoint();
                         G4double edepStepLen = edepStep.mag();
                         int numSamples = (int) ceil(2*(edepStepLen/mm)/fabs(edep_dens_dz));
@@ -1236,7 +1402,17 @@ void RootFileWriter::doEvent(const G4Event* event){
                     }
                 }
 
-                magnet_edep[magIdx]->Fill(edep/MeV);
+                if (statsOnly) {
+                    magnet_edep_sum[magIdx]  += edep/MeV;
+                    magnet_edep_sum2[magIdx] += (edep/MeV)*(edep/MeV);
+                }
+                else {
+                    magnet_edep[magIdx]->Fill(edep/MeV);
+                }
+
+                if (eventTrigger.IsActive()) {
+                    eventTrigger.AddEdep(triggerIdx_magnets[magIdx], edep/MeV);
+                }
 
                 //TTree, for event-by-event analysis
                 if (not miniFile){
@@ -1278,6 +1454,10 @@ void RootFileWriter::doEvent(const G4Event* event){
                         // We are on the downstream exit face.
                         // Note: Coordinates in global coordinates.
 
+                        if (eventTrigger.IsActive()) {
+                            eventTrigger.AddHit(triggerIdx_magnets[magIdx], energy/MeV, hitR/mm);
+                        }
+
                         //Particle type counting
                         FillParticleTypes(typeCounter[magName], PDG, type);
                         if (energy/MeV > beamEnergy*beamEnergy_cutoff and hitR/mm < position_cutoffR) {
@@ -1316,39 +1496,42 @@ void RootFileWriter::doEvent(const G4Event* event){
                             }
                         }
 
-                        //R position
-                        if (magnet_exit_Rpos[magIdx].find(PDG) != magnet_exit_Rpos[magIdx].end()) {
-                            magnet_exit_Rpos[magIdx][PDG]->Fill(hitR/mm);
-                        }
-                        else {
-                            magnet_exit_Rpos[magIdx][0]->Fill(hitR/mm);
-                        }
-                        if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
-                            if (magnet_exit_Rpos_cutoff[magIdx].find(PDG) !=
-                                magnet_exit_Rpos_cutoff[magIdx].end()) {
-                                magnet_exit_Rpos_cutoff[magIdx][PDG]->Fill(hitR/mm);
+                        // Histograms (none in statsOnly mode)
+                        if (not statsOnly) {
+                            //R position
+                            if (magnet_exit_Rpos[magIdx].find(PDG) != magnet_exit_Rpos[magIdx].end()) {
+                                magnet_exit_Rpos[magIdx][PDG]->Fill(hitR/mm);
                             }
                             else {
-                                magnet_exit_Rpos_cutoff[magIdx][0]->Fill(hitR/mm);
+                                magnet_exit_Rpos[magIdx][0]->Fill(hitR/mm);
+                            }
+                            if (energy/MeV > beamEnergy*beamEnergy_cutoff) {
+                                if (magnet_exit_Rpos_cutoff[magIdx].find(PDG) !=
+                                    magnet_exit_Rpos_cutoff[magIdx].end()) {
+                                    magnet_exit_Rpos_cutoff[magIdx][PDG]->Fill(hitR/mm);
+                                }
+                                else {
+                                    magnet_exit_Rpos_cutoff[magIdx][0]->Fill(hitR/mm);
+                                }
                             }
-                        }
-
-                        //Energy
-                        if (magnet_exit_energy[magIdx].find(PDG) !=
-                            magnet_exit_energy[magIdx].end()) {
-                            magnet_exit_energy[magIdx][PDG]->Fill(energy/MeV);
-                        }
-                        else {
-                            magnet_exit_energy[magIdx][0]->Fill(energy/MeV);
-                        }
 
-                        if (hitR/mm < position_cutoffR) {
-                            if (magnet_exit_cutoff_energy[magIdx].find(PDG) !=
-                                magnet_exit_cutoff_energy[magIdx].end()) {
-                                magnet_exit_cutoff_energy[magIdx][PDG]->Fill(energy/MeV);
+                            //Energy
+                            if (magnet_exit_energy[magIdx].find(PDG) !=
+                                magnet_exit_energy[magIdx].end()) {
+                                magnet_exit_energy[magIdx][PDG]->Fill(energy/MeV);
                             }
                             else {
-                                magnet_exit_cutoff_energy[magIdx][0]->Fill(energy/MeV);
+                                magnet_exit_energy[magIdx][0]->Fill(energy/MeV);
+                            }
+
+                            if (hitR/mm < position_cutoffR) {
+                                if (magnet_exit_cutoff_energy[magIdx].find(PDG) !=
+                                    magnet_exit_cutoff_energy[magIdx].end()) {
+                                    magnet_exit_cutoff_energy[magIdx][PDG]->Fill(energy/MeV);
+                                }
+                                else {
+                                    magnet_exit_cutoff_energy[magIdx][0]->Fill(energy/MeV);
+                                }
                             }
                         }
                     }
@@ -1369,7 +1552,7 @@ void RootFileWriter::doEvent(const G4Event* event){
                         targetExitBuffer.PDG = PDG;
                         targetExitBuffer.charge = charge;
 
-                        targetExitBuffer.eventID = eventCounter;
+                        targetExitBuffer.eventID = GetEventID();
 
                         targetExit->Fill();
                     }
@@ -1384,10 +1567,355 @@ void RootFileWriter::doEvent(const G4Event* event){
             G4cout << "MagnetExitpos_CollID was " << MagnetExitpos_CollID << " < 0 for '" << magName << "'!"<<G4endl;
         }
     } // END loop over magnets
+
+    // Histograms see every event, the TTrees only those passing the trigger
+    const G4bool triggerPassed = (not eventTrigger.IsActive()) or eventTrigger.Evaluate();
+
     if (not miniFile) {
-        magnetEdeps->Fill(); // Outside loop over magnets
+        // Start a new chunk file before filling, so that the last chunk is never empty
+        if (chunkEvents > 0 or chunkSizeMB > 0.0) {
+            if (chunkFile == NULL) {
+                // Closed when writing the last checkpoint
+                OpenChunkFile();
+            }
+            else if ( (chunkEvents > 0 and chunkNumEvents >= chunkEvents) or
+                      (chunkSizeMB > 0.0 and GetChunkFileSize() >= chunkSizeMB*1e6) ) {
+                CloseChunkFile();
+                OpenChunkFile();
+            }
+            if (chunkNumEvents == 0) {
+                chunkFirstEvent = GetEventID();
+            }
+            chunkNumEvents++;
+        }
+
+        if (triggerPassed) {
+            FillHitTrees();
+            magnetEdepsEventID = GetEventID();
+            magnetEdeps->Fill(); // Outside loop over magnets
+        }
+        else {
+            ClearHitStaging();
+        }
+    }
+
+    if (eventRNG != NULL and (recordRNG == "all" or triggerPassed)) {
+        eventRNGBuffer.eventID  = GetEventID();
+        eventRNGBuffer.rngState = genAct->GetEventRNGState();
+        eventRNGBuffer.x        = genAct->x/mm;
+        eventRNGBuffer.xp       = genAct->xp/rad;
+        eventRNGBuffer.y        = genAct->y/mm;
+        eventRNGBuffer.yp       = genAct->yp/rad;
+        eventRNGBuffer.E        = genAct->E/MeV;
+        eventRNG->Fill();
+    }
+
+    if (precision.IsActive()) {
+        precision.EndOfEvent();
+    }
+
+    WriteCheckpointIfDue();
+    WriteLiveSnapshotIfDue();
+    WriteProgressIfDue();
+}
+
+void RootFileWriter::SetupEventTrigger() {
+    // Event trigger for the TTrees
+    G4RunManager*                    run    = G4RunManager::GetRunManager();
+    DetectorConstruction*            detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+    VirtualTrackerWorldConstruction* traCon = VirtualTrackerWorldConstruction::getInstance();
+
+    if (eventTrigger.IsActive()) {
+        if (miniFile) {
+            G4cout << "Note: Event trigger has no effect when there are no TTrees (miniROOTfile)." << G4endl;
+        }
+        if (detCon->GetHasTarget()) {
+            triggerIdx_target = eventTrigger.RegisterDetector("target");
+        }
+        triggerIdx_trackers.clear();
+        for (int idx = 0; idx < traCon->getNumTrackers(); idx++) {
+            if (traCon->getNumTrackers() == 1) {
+                triggerIdx_trackers.push_back(eventTrigger.RegisterDetector("tracker"));
+            }
+            else {
+                triggerIdx_trackers.push_back(eventTrigger.RegisterDetector(std::string("tracker_") + std::to_string(idx+1)));
+            }
+        }
+        triggerIdx_magnets.clear();
+        for (auto mag : detCon->magnets) {
+            triggerIdx_magnets.push_back(eventTrigger.RegisterDetector(mag->magnetName));
+        }
+        eventTrigger.SetPositionCutoffR(position_cutoffR);
+        eventTrigger.Resolve();
+    }
+}
+
+void RootFileWriter::CreateHitTrees() {
+    // Create the TTrees in the current directory
+    G4RunManager*         run    = G4RunManager::GetRunManager();
+    DetectorConstruction* detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+
+    if (detCon->GetHasTarget()) {
+        CreateHitTree(targetExit, "TargetExit", "TargetExit tree",
+                      targetExitBuffer, targetExitEventBuffer);
+    }
+    CreateHitTree(trackerHits, "TrackerHits", "TrackerHits tree",
+                  trackerHitsBuffer, trackerHitsEventBuffer);
+
+    magnetEdeps = new TTree("magnetEdeps", "Magnet Edeps tree");
+    // Only the events passing the trigger are filled, so the rows are matched to events by the eventID
+    magnetEdeps->Branch("eventID", &magnetEdepsEventID, "eventID/L");
+    size_t i = 0;
+    for (auto mag : detCon->magnets) {
+        G4String magName = mag->magnetName;
+        magnetEdeps->Branch(magName, &(magnetEdepsBuffer[i]), (magName+"/D").c_str());
+        i++;
+    }
+}
+
+void RootFileWriter::OpenChunkFile() {
+    chunkNumber++;
+    std::ostringstream chunkName;
+    chunkName << filename_out << "_chunk" << std::setw(4) << std::setfill('0') << chunkNumber << ".root";
+    chunkFileName = chunkName.str();
+
+    G4String chunkPath = foldername_out + "/" + chunkFileName;
+    G4cout << "Opening TTree chunk file '" << chunkPath << "'" << G4endl;
+    chunkFile = new TFile(chunkPath, "RECREATE");
+    if ( not chunkFile->IsOpen() ) {
+        G4cerr << "Opening TFile '" << chunkPath << "' failed; quitting." << G4endl;
+        exit(1);
     }
+    CreateHitTrees(); // Created in the chunk file, since it is now the current directory
+    histFile->cd();   // Everything else goes in the main file
+
+    chunkFirstEvent = 0; // Set when the first event is counted
+    chunkNumEvents  = 0;
+}
+
+Long64_t RootFileWriter::GetChunkFileSize() {
+    // GetEND() only counts what is already written to the file
+    Long64_t size = chunkFile->GetEND();
+    for (TTree* tree : {targetExit, trackerHits, magnetEdeps}) {
+        if (tree == NULL) continue;
+        std::set<TBranch*> branches;
+        TIter nextLeaf(tree->GetListOfLeaves());
+        while (TLeaf* leaf = (TLeaf*) nextLeaf()) {
+            branches.insert(leaf->GetBranch());
+        }
+        for (auto branch : branches) {
+            TBasket* basket = (TBasket*) branch->GetListOfBaskets()->At(branch->GetWriteBasket());
+            if (basket != NULL) {
+                size += basket->GetBufferRef()->Length() - basket->GetKeylen();
+            }
+        }
+    }
+    return size;
+}
+
+void RootFileWriter::CloseChunkFile() {
+    chunkFile->cd();
+
+    chunkIndexEntry entry;
+    entry.fileName          = chunkFileName;
+    entry.firstEvent        = chunkFirstEvent;
+    entry.lastEvent         = chunkFirstEvent + chunkNumEvents - 1;
+    entry.targetExitEntries = (targetExit != NULL) ? targetExit->GetEntries() : 0;
+    entry.trackerHitsEntries= trackerHits->GetEntries();
+    entry.magnetEdepsEntries= magnetEdeps->GetEntries();
+    chunkIndex.push_back(entry);
+
+    if (targetExit != NULL) {
+        targetExit->Write(NULL, TObject::kOverwrite);
+        delete targetExit; targetExit = NULL;
+    }
+    trackerHits->Write(NULL, TObject::kOverwrite);
+    delete trackerHits; trackerHits = NULL;
+    magnetEdeps->Write(NULL, TObject::kOverwrite);
+    delete magnetEdeps; magnetEdeps = NULL;
+
+    chunkFile->Close();
+    delete chunkFile; chunkFile = NULL;
+    histFile->cd();
+
+    // Rewrite the index after every chunk, so that it is valid even if the run crashes.
+    // Write to a temporary file first, then rename it into place (atomic on POSIX).
+    G4String tmpName = chunkIndexFileName + ".tmp";
+    std::ofstream indexFile(tmpName);
+    if (not indexFile.is_open()) {
+        G4cerr << "Error: could not open chunk index file '" << tmpName << "' for writing." << G4endl;
+        exit(1);
+    }
+    indexFile << "# MiniScatter TTree chunk index for '" << filename_out << ".root'" << std::endl
+              << "# chunk firstEvent lastEvent TargetExit_entries TrackerHits_entries magnetEdeps_entries filename" << std::endl;
+    for (size_t i = 0; i < chunkIndex.size(); i++) {
+        indexFile << (i+1) << " "
+                  << chunkIndex[i].firstEvent << " "
+                  << chunkIndex[i].lastEvent << " "
+                  << chunkIndex[i].targetExitEntries << " "
+                  << chunkIndex[i].trackerHitsEntries << " "
+                  << chunkIndex[i].magnetEdepsEntries << " "
+                  << chunkIndex[i].fileName << std::endl;
+    }
+    indexFile.close();
+    if (rename(tmpName.c_str(), chunkIndexFileName.c_str()) != 0) {
+        perror("Error renaming chunk index file");
+        exit(1);
+    }
+}
+
+void RootFileWriter::CreateHitTree(TTree*& tree, const char* name, const char* title,
+                                   trackerHitStruct& buffer, trackerHitEventStruct& eventBuffer) {
+    tree = new TTree(name, title);
+    if (not perEventTrees) {
+        tree->Branch((G4String(name)+"Branch").c_str(), &buffer,
+                     "x/D:y:z:px:py:pz:E:PDG/I:charge:eventID/L");
+    }
+    else {
+        // One entry per event, each field is an array with one element per hit
+        tree->Branch("eventID", &(eventBuffer.eventID), "eventID/L");
+        tree->Branch("x",       &(eventBuffer.x));
+        tree->Branch("y",       &(eventBuffer.y));
+        tree->Branch("z",       &(eventBuffer.z));
+        tree->Branch("px",      &(eventBuffer.px));
+        tree->Branch("py",      &(eventBuffer.py));
+        tree->Branch("pz",      &(eventBuffer.pz));
+        tree->Branch("E",       &(eventBuffer.E));
+        tree->Branch("PDG",     &(eventBuffer.PDG));
+        tree->Branch("charge",  &(eventBuffer.charge));
+    }
+}
+
+void RootFileWriter::FillHitTrees() {
+    // Move the hits staged during doEvent() into the TTrees
+    if (targetExit != NULL) {
+        if (perEventTrees) {
+            targetExitEventBuffer.clear();
+            targetExitEventBuffer.eventID = GetEventID();
+        }
+        for (const auto& hit : targetExitStaging) {
+            if (not FilterHit(0, hit)) continue;
+            if (perEventTrees) {
+                targetExitEventBuffer.push_back(hit);
+            }
+            else {
+                targetExitBuffer = hit;
+                targetExit->Fill();
+            }
+        }
+        if (perEventTrees) {
+            targetExit->Fill();
+        }
+    }
+    targetExitStaging.clear();
+
+    if (perEventTrees) {
+        trackerHitsEventBuffer.clear();
+        trackerHitsEventBuffer.eventID = GetEventID();
+    }
+    for (size_t idx = 0; idx < trackerHitsStaging.size(); idx++) {
+        for (const auto& hit : trackerHitsStaging[idx]) {
+            if (not FilterHit(idx+1, hit)) continue;
+            if (perEventTrees) {
+                trackerHitsEventBuffer.push_back(hit);
+            }
+            else {
+                trackerHitsBuffer = hit;
+                trackerHits->Fill();
+            }
+        }
+        trackerHitsStaging[idx].clear();
+    }
+    if (perEventTrees) {
+        trackerHits->Fill();
+    }
+}
+
+void RootFileWriter::ClearHitStaging() {
+    // Drop the hits of an event failing the trigger, counting them in the statistics
+    hitTreeStats[0].numHits          += targetExitStaging.size();
+    hitTreeStats[0].numTriggerFailed += targetExitStaging.size();
+    targetExitStaging.clear();
+    for (size_t idx = 0; idx < trackerHitsStaging.size(); idx++) {
+        hitTreeStats[idx+1].numHits          += trackerHitsStaging[idx].size();
+        hitTreeStats[idx+1].numTriggerFailed += trackerHitsStaging[idx].size();
+        trackerHitsStaging[idx].clear();
+    }
+}
+
+G4bool RootFileWriter::FilterHit(G4int planeIdx, const trackerHitStruct& hit) {
+    // Returns true if the hit should be written to the TTree right away
+    hitTreePlaneStats& stats = hitTreeStats[planeIdx];
+    stats.numHits++;
+
+    if (not treeFilter.Accept(planeIdx, hit.PDG, hit.E, sqrt(hit.x*hit.x + hit.y*hit.y))) {
+        return false;
+    }
+    stats.numPassed++;
+
+    if (treeReservoir > 0) {
+        // Reservoir sampling (Vitter's algorithm R): every passing hit has the same
+        // probability to be among the stored ones. They are written in finalizeRootFile().
+        if (stats.reservoir.size() < (size_t) treeReservoir) {
+            stats.reservoir.push_back(hit);
+        }
+        else {
+            Long64_t j = (Long64_t) (reservoirRNG->Rndm() * stats.numPassed);
+            if (j < treeReservoir) {
+                stats.reservoir[j] = hit;
+            }
+        }
+        return false;
+    }
+
+    stats.numStored++;
+    return true;
+}
+
+void RootFileWriter::WriteHitTreeStats() {
+    // Write the reservoirs to the TTrees, and the tree filter statistics
+    if (treeReservoir > 0) {
+        for (size_t planeIdx = 0; planeIdx < hitTreeStats.size(); planeIdx++) {
+            hitTreePlaneStats& stats = hitTreeStats[planeIdx];
+            TTree* tree = (planeIdx == 0) ? targetExit : trackerHits;
+            if (tree == NULL) continue;
+
+            std::stable_sort(stats.reservoir.begin(), stats.reservoir.end(),
+                             [](const trackerHitStruct& a, const trackerHitStruct& b) { return a.eventID < b.eventID; });
+            trackerHitStruct& buffer = (planeIdx == 0) ? targetExitBuffer : trackerHitsBuffer;
+            for (auto hit : stats.reservoir) {
+                buffer = hit;
+                tree->Fill();
+            }
+            stats.numStored = stats.reservoir.size();
+            stats.reservoir.clear();
+        }
+    }
+
+    if (not (treeFilter.IsActive() or treeReservoir > 0)) return;
+
+    G4cout << "TTree filter statistics (hits / in events failing the trigger / passed filter / stored):" << G4endl;
+    for (auto& stats : hitTreeStats) {
+        if (stats.name == "target" and targetExit == NULL) continue;
+        G4cout << std::setw(15) << stats.name << " : "
+               << stats.numHits << " / " << stats.numTriggerFailed << " / "
+               << stats.numPassed << " / " << stats.numStored << G4endl;
+
+        // [hits, passed filter, stored, treeReservoir, hits in events failing the trigger]
+        TVectorD statsVector(5);
+        statsVector[0] = double(stats.numHits);
+        statsVector[1] = double(stats.numPassed);
+        statsVector[2] = double(stats.numStored);
+        statsVector[3] = double(treeReservoir);
+        statsVector[4] = double(stats.numTriggerFailed);
+        WriteObject(&statsVector, (stats.name + "_treeFilterStats").c_str());
+    }
+    G4cout << G4endl;
+
+    TNamed filterDefinition("treeFilter", treeFilter.GetDefinition().c_str());
+    WriteObject(&filterDefinition);
 }
+
 void RootFileWriter::finalizeRootFile() {
 
     //Needed for some of the processing
@@ -1395,6 +1923,19 @@ void RootFileWriter::finalizeRootFile() {
     DetectorConstruction*            detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
     VirtualTrackerWorldConstruction* traCon = VirtualTrackerWorldConstruction::getInstance();
 
+    WriteProgress("finalizing");
+
+    // An interrupted run can later be continued with --resume
+    G4bool interrupted = (stopReason == STOP_WALLTIME or stopReason == STOP_SIGNAL);
+    if (interrupted and (checkpointEvents > 0 or checkpointTime > 0.0)) {
+        WriteCheckpoint();
+    }
+
+    // Runs with fewer hits than --autoRange in some plane
+    for (auto ps : GetAllPhaseSpaces()) {
+        ps->EndWarmup();
+    }
+
     //Print out the particle types on all detector planes
     for (auto it : typeCounter) {
         PrintParticleTypes(it.second, it.first);
@@ -1454,6 +1995,9 @@ void RootFileWriter::finalizeRootFile() {
     G4cout << "** Metadata **" << G4endl;
     G4cout << "eventCounter  = " << eventCounter << G4endl;
     G4cout << "numEvents     = " << numEvents    << G4endl;
+    if (eventIDOffset != 0) {
+        G4cout << "eventIDOffset = " << eventIDOffset << G4endl;
+    }
     if (detCon->GetHasTarget()) {
         G4cout << "targetDensity = " << detCon->GetTargetMaterialDensity()*cm3/g
                                      << " [g/cm^3]" << G4endl;
@@ -1463,7 +2007,14 @@ void RootFileWriter::finalizeRootFile() {
                                      << " [g/cm^3]" << G4endl;
     }
 
-    TVectorD metadataVector (3);
+    if (stopReason != STOP_NONE) {
+        G4cout << "stopReason    = " << stopReason
+               << " (1 = precision reached, 2 = maxWallTime, 3 = signal)" << G4endl;
+    }
+
+    // [eventCounter, numEvents, targetDensity [g/cm^3], stopReason, stop signal number]
+    // eventCounter is the number of events actually simulated, which is less than numEvents if stopReason != 0.
+    TVectorD metadataVector (5);
     metadataVector[0] = double(eventCounter);
     metadataVector[1] = double(numEvents);
     if (detCon->GetHasTarget()) {
@@ -1472,14 +2023,89 @@ void RootFileWriter::finalizeRootFile() {
     else {
         metadataVector[2] = 0.0;
     }
-    metadataVector.Write("metadata");
+    metadataVector[3] = double(stopReason);
+    metadataVector[4] = (stopReason == STOP_SIGNAL) ? double(stopSignal) : 0.0;
+    WriteObject(&metadataVector, "metadata");
+
+    // The event counts as 64-bit integers; the doubles above are only exact up to 2^53.
+    TTree* metadataCounts = new TTree("metadataCounts", "Event counts [eventCounter, numEvents, eventIDOffset]");
+    metadataCounts->Branch("eventCounter",  &eventCounter,  "eventCounter/L");
+    metadataCounts->Branch("numEvents",     &numEvents,     "numEvents/L");
+    metadataCounts->Branch("eventIDOffset", &eventIDOffset, "eventIDOffset/L");
+    metadataCounts->Fill();
+    WriteObject(metadataCounts);
+    delete metadataCounts;
     G4cout << G4endl;
 
+    // [startup time [s], run time [s], events/s], for comparing e.g. physics lists.
+    // The time and events are for this process only, i.e. after the checkpoint when resuming.
+    std::chrono::duration<double> runDuration = std::chrono::steady_clock::now() - runStartTime;
+    TVectorD timingVector(3);
+    timingVector[0] = startupTime;
+    timingVector[1] = runDuration.count();
+    timingVector[2] = (runDuration.count() > 0.0) ? double(eventCounter - resumedEvents)/runDuration.count() : 0.0;
+    WriteObject(&timingVector, "timing");
+    G4cout << "Startup time = " << timingVector[0] << " [s], run time = " << timingVector[1] << " [s], "
+           << "throughput = " << timingVector[2] << " [events/s]" << G4endl << G4endl;
+
     // Magnet metadata
     for (auto mag : detCon->magnets) {
         TVectorD magnetMetadataVector(1);
         magnetMetadataVector[0] = double(mag->GetTypicalDensity()*cm3/g);
-        magnetMetadataVector.Write((mag->magnetName + "_metadata").c_str());
+        WriteObject(&magnetMetadataVector, (mag->magnetName + "_metadata").c_str());
+    }
+
+    // Counters of the optional features, e.g. 'stacking' = [number of tracks, kinetic energy [MeV]] per rule
+    for (auto& it : RunCounters::GetAll()) {
+        it.second.Print();
+        G4cout << G4endl;
+        const std::vector<G4double>& values = it.second.GetValues();
+        TVectorD countersVector(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            countersVector[i] = values[i];
+        }
+        WriteObject(&countersVector, it.first.c_str());
+    }
+    StackingAction* stackAct = (StackingAction*)run->GetUserStackingAction();
+    if (stackAct != NULL) {
+        TObjString stackingDefinition(stackAct->GetDefinition().c_str());
+        WriteObject(&stackingDefinition, "stacking_rules");
+    }
+
+    // Scoring planes: one row per plane in each matrix, ordered as 'planes_z'.
+    // Named ..._TWISSMATRIX and ..._MOMENTSMATRIX, since getData() expects a TVectorD in every ..._TWISS
+    if (planeScorer != NULL) {
+        const size_t numPlanes = planeScorer->GetNumPlanes();
+        G4long sumHits = 0;
+        TVectorD planesZ(numPlanes);
+        TVectorD planesNumHits(numPlanes);
+        for (size_t idx = 0; idx < numPlanes; idx++) {
+            planesZ[idx]       = planeScorer->GetDistances()[idx]/mm;
+            planesNumHits[idx] = double(planeScorer->GetNumHits(idx));
+            sumHits           += planeScorer->GetNumHits(idx);
+        }
+        WriteObject(&planesZ,       "planes_z");
+        WriteObject(&planesNumHits, "planes_numHits");
+
+        const std::vector<std::pair<G4String, const MomentAccumulator2D& (PlaneScorer::*)(size_t) const>> planeMoments =
+            { {"planes_x",        &PlaneScorer::GetMomentsX},
+              {"planes_y",        &PlaneScorer::GetMomentsY},
+              {"planes_x_cutoff", &PlaneScorer::GetMomentsX_cutoff},
+              {"planes_y_cutoff", &PlaneScorer::GetMomentsY_cutoff} };
+        for (auto pm : planeMoments) {
+            TMatrixD twissMatrix  (numPlanes, 8);
+            TMatrixD momentsMatrix(numPlanes, MomentAccumulator2D::numRawMoments);
+            for (size_t idx = 0; idx < numPlanes; idx++) {
+                const MomentAccumulator2D& moments = (planeScorer->*(pm.second))(idx);
+                TMatrixDRow(twissMatrix,   idx) = GetTwissVector(moments);
+                TMatrixDRow(momentsMatrix, idx) = moments.GetRawMoments();
+            }
+            WriteObject(&twissMatrix,   (pm.first+"_TWISSMATRIX").c_str());
+            WriteObject(&momentsMatrix, (pm.first+"_MOMENTSMATRIX").c_str());
+        }
+
+        G4cout << "Scored " << numPlanes << " planes without geometry volumes, with " << sumHits << " crossings in total"
+               << G4endl << G4endl;
     }
     
 
@@ -1517,7 +2143,34 @@ void RootFileWriter::finalizeRootFile() {
         }
     }
 
-    if (anaScatterTest and detCon->GetHasTarget()) {
+    // Histogram ranges chosen with --autoRange:
+    // [posMin [mm], posMax [mm], angMin [rad], angMax [rad], number of hits used]
+    for (auto ps : GetAllPhaseSpaces()) {
+        if (not ps->autoRanged) continue;
+        TVectorD rangeVector(5);
+        rangeVector[0] = ps->hist->GetXaxis()->GetXmin();
+        rangeVector[1] = ps->hist->GetXaxis()->GetXmax();
+        rangeVector[2] = ps->hist->GetYaxis()->GetXmin();
+        rangeVector[3] = ps->hist->GetYaxis()->GetXmax();
+        rangeVector[4] = double(ps->numWarmupHits);
+        WriteObject(&rangeVector, (ps->name+"_RANGE").c_str());
+    }
+
+    if (precision.IsActive()) {
+        G4cout << "** Precision targets **" << G4endl;
+        for (size_t i = 0; i < precision.GetNumTargets(); i++) {
+            TVectorD precisionVector = precision.GetResult(i);
+            G4cout << std::setw(30) << precision.GetTargetName(i) << " : "
+                   << "relErr = " << precisionVector[1] << " (requested " << precisionVector[0] << ")"
+                   << ", from " << precisionVector[3] << " batches" << G4endl;
+            WriteObject(&precisionVector, (precision.GetTargetName(i) + "_PRECISION").c_str());
+        }
+        G4cout << (precision.IsConverged() ? "Run stopped when the precision targets were reached." :
+                                              "Precision targets were NOT reached within the maximum number of events.")
+               << G4endl << G4endl;
+    }
+
+    if (anaScatterTest and detCon->GetHasTarget() and not statsOnly) {
         // Compute the analytical multiple scattering angle distribution
         // Formulas from various sources:
         //
@@ -1577,7 +2230,7 @@ void RootFileWriter::finalizeRootFile() {
                << "                = " << theta0/deg << " [deg]" << G4endl;
         G4cout << G4endl;
 
-        target_exitangle_hist_cutoff->Write(); // Write the unaltered histogram
+        WriteObject(target_exitangle_hist_cutoff); // Write the unaltered histogram
 
         //Plot the analytical scattering distribution and the histogram together
         TCanvas* c1 = new TCanvas("scatterPlot");
@@ -1613,81 +2266,81 @@ void RootFileWriter::finalizeRootFile() {
 
         G4String plot_filename = foldername_out + "/" + filename_out + "_angles.png";
         //c1->SaveAs(plot_filename);
-        c1->Write();
+        WriteObject(c1);
 
         // Write the ROOT file.
-        exitangle_analytic->Write();
+        WriteObject(exitangle_analytic);
         delete exitangle_analytic; exitangle_analytic = NULL;
     }
 
 
-    if (not quickmode) { //Write the 2D and 3D histograms to the ROOT file (slow)
+    if (not quickmode and not statsOnly) { //Write the 2D and 3D histograms to the ROOT file (slow)
 
         G4cout << "Writing 2D histograms..." << G4endl;
-        init_phasespaceX->Write();
-        init_phasespaceY->Write();
-        init_phasespaceXY->Write();
+        WriteObject(init_phasespaceX->hist);
+        WriteObject(init_phasespaceY->hist);
+        WriteObject(init_phasespaceXY);
 
         if (detCon->GetHasTarget()) {
-            target_exit_phasespaceX->Write();
-            target_exit_phasespaceY->Write();
+            WriteObject(target_exit_phasespaceX->hist);
+            WriteObject(target_exit_phasespaceY->hist);
 
-            target_exit_phasespaceX_cutoff->Write();
-            target_exit_phasespaceY_cutoff->Write();
+            WriteObject(target_exit_phasespaceX_cutoff->hist);
+            WriteObject(target_exit_phasespaceY_cutoff->hist);
 
-	    target_exit_phasespaceXY->Write();
-	    target_exit_phasespaceXY_cutoff->Write();
+	    WriteObject(target_exit_phasespaceXY);
+	    WriteObject(target_exit_phasespaceXY_cutoff);
 
             if (target_edep_rdens != NULL) {
-                target_edep_rdens->Write();
+                WriteObject(target_edep_rdens);
             }
         }
 
         for (int idx = 0; idx < traCon->getNumTrackers(); idx++) {
-            tracker_phasespaceX[idx]->Write();
-            tracker_phasespaceY[idx]->Write();
-	    tracker_phasespaceXY[idx]->Write();
+            WriteObject(tracker_phasespaceX[idx]->hist);
+            WriteObject(tracker_phasespaceY[idx]->hist);
+	    WriteObject(tracker_phasespaceXY[idx]);
 
-            tracker_phasespaceX_cutoff[idx]->Write();
-            tracker_phasespaceY_cutoff[idx]->Write();
-	    tracker_phasespaceXY_cutoff[idx]->Write();
+            WriteObject(tracker_phasespaceX_cutoff[idx]->hist);
+            WriteObject(tracker_phasespaceY_cutoff[idx]->hist);
+	    WriteObject(tracker_phasespaceXY_cutoff[idx]);
 
             for (auto PDG : tracker_phasespaceX_cutoff_PDG[idx]) {
-                PDG.second->Write();
+                WriteObject(PDG.second->hist);
             }
             for (auto PDG : tracker_phasespaceY_cutoff_PDG[idx]) {
-                PDG.second->Write();
+                WriteObject(PDG.second->hist);
             }
 	    for (auto PDG : tracker_phasespaceXY_cutoff_PDG[idx]) {
-	      PDG.second->Write();
+	      WriteObject(PDG.second);
 	    }
         }
 
         for (auto it : magnet_edep_rdens) {
             if (it != NULL) {
-                it->Write();
+                WriteObject(it);
 	    }
         }
         for (auto it : magnet_exit_phasespaceX) {
-            it->Write();
+            WriteObject(it->hist);
         }
         for (auto it : magnet_exit_phasespaceY) {
-            it->Write();
+            WriteObject(it->hist);
         }
         for (auto it : magnet_exit_phasespaceX_cutoff) {
-            it->Write();
+            WriteObject(it->hist);
         }
         for (auto it : magnet_exit_phasespaceY_cutoff) {
-            it->Write();
+            WriteObject(it->hist);
         }
         for (auto mag : magnet_exit_phasespaceX_cutoff_PDG) {
             for (auto PDG : mag) {
-                PDG.second->Write();
+                WriteObject(PDG.second->hist);
             }
         }
         for (auto mag : magnet_exit_phasespaceY_cutoff_PDG) {
             for (auto PDG : mag) {
-                PDG.second->Write();
+                WriteObject(PDG.second->hist);
             }
         }
 
@@ -1695,28 +2348,56 @@ void RootFileWriter::finalizeRootFile() {
         G4cout << "Writing 3D histograms..." << G4endl;
         if (detCon->GetHasTarget()) {
             if (target_edep_dens != NULL) {
-                target_edep_dens->Write();
+                WriteObject(target_edep_dens);
             }
         }
         if (this->edep_dens_dz > 0.0 ) {
             for (auto it : magnet_edep_dens) {
-                it->Write();
+                WriteObject(it);
             }
         }
 
     }
 
     if (not miniFile) {
+        WriteHitTreeStats();
+
+        if (eventTrigger.IsActive()) {
+            G4cout << "Event trigger '" << eventTrigger.GetDefinition() << "': "
+                   << eventTrigger.GetNumPassed() << " of " << eventTrigger.GetNumEvaluated()
+                   << " events written to the TTrees." << G4endl << G4endl;
+
+            TVectorD triggerVector(2);
+            triggerVector[0] = double(eventTrigger.GetNumEvaluated());
+            triggerVector[1] = double(eventTrigger.GetNumPassed());
+            WriteObject(&triggerVector, "eventTrigger_stats");
+
+            TNamed triggerDefinition("eventTrigger", eventTrigger.GetDefinition().c_str());
+            WriteObject(&triggerDefinition);
+        }
+
         G4cout << "Writing TTrees..." << G4endl;
 
-        if (detCon->GetHasTarget()) {
-            targetExit->Write();
+        if (chunkEvents > 0 or chunkSizeMB > 0.0) {
+            if (chunkFile != NULL) {
+                CloseChunkFile();
+            }
+            G4cout << "TTrees written to " << chunkIndex.size() << " chunk files, "
+                   << "see the index file '" << chunkIndexFileName << "'" << G4endl;
+            TNamed chunkIndexName("chunkIndex", chunkIndexFileName.c_str());
+            WriteObject(&chunkIndexName);
         }
-        trackerHits->Write();
+        else {
+            // Overwrite the headers left by TTree::AutoSave, leaving a single key cycle
+            if (detCon->GetHasTarget()) {
+                WriteObject(targetExit, NULL, TObject::kOverwrite);
+            }
+            WriteObject(trackerHits, NULL, TObject::kOverwrite);
 
-        magnetEdeps->Write();
-        delete magnetEdeps;
-        magnetEdeps=NULL;
+            WriteObject(magnetEdeps, NULL, TObject::kOverwrite);
+            delete magnetEdeps;
+            magnetEdeps=NULL;
+        }
 
         if (magnetEdepsBuffer != NULL) {
             delete magnetEdepsBuffer;
@@ -1724,70 +2405,82 @@ void RootFileWriter::finalizeRootFile() {
         }
     }
 
+    if (eventRNG != NULL) {
+        G4cout << "Recorded the RNG state for " << eventRNG->GetEntries() << " events (eventRNG TTree)" << G4endl;
+        WriteObject(eventRNG, NULL, TObject::kOverwrite);
+        delete eventRNG; eventRNG = NULL;
+    }
+
+    if (statsOnly) {
+        FinalizeStatsOnly();
+        CloseRootFile();
+        return;
+    }
+
     G4cout << "Writing 1D histograms..." << G4endl;
 
-    init_E->Write();
+    WriteObject(init_E);
     delete init_E; init_E = NULL;
 
     if (detCon->GetHasTarget()) {
-        targetEdep->Write();
+        WriteObject(targetEdep);
         delete targetEdep;      targetEdep      = NULL;
-        targetEdep_NIEL->Write();
+        WriteObject(targetEdep_NIEL);
         delete targetEdep_NIEL; targetEdep_NIEL = NULL;
-        targetEdep_IEL->Write();
+        WriteObject(targetEdep_IEL);
         delete targetEdep_IEL;  targetEdep_IEL  = NULL;
 
-        target_exitangle_hist->Write();
+        WriteObject(target_exitangle_hist);
         delete target_exitangle_hist; target_exitangle_hist = NULL;
 
         // (Loops over particle types)
         for (auto it : target_exit_energy) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         target_exit_energy.clear();
         for (auto it : target_exit_cutoff_energy) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         target_exit_cutoff_energy.clear();
         for (auto it: target_exit_Rpos) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         target_exit_Rpos.clear();
         for (auto it: target_exit_Rpos_cutoff) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         target_exit_Rpos_cutoff.clear();
     }
 
     for (int idx = 0; idx < traCon->getNumTrackers(); idx++) {
-        tracker_numParticles[idx]->Write();
+        WriteObject(tracker_numParticles[idx]);
         delete tracker_numParticles[idx]; tracker_numParticles[idx] = NULL;
 
-        tracker_energy[idx]->Write();
+        WriteObject(tracker_energy[idx]);
         delete tracker_energy[idx]; tracker_energy[idx] = NULL;
 
         for (auto it : tracker_type_energy[idx]) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         tracker_type_energy[idx].clear();
         for (auto it : tracker_type_cutoff_energy[idx]) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         tracker_type_cutoff_energy[idx].clear();
 
         for (auto it: tracker_Rpos[idx]) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }
         tracker_Rpos[idx].clear();
         for (auto it: tracker_Rpos_cutoff[idx]) {
-            it.second->Write();
+            WriteObject(it.second);
             delete it.second;
         }   
         tracker_Rpos_cutoff[idx].clear();
@@ -1846,14 +2539,14 @@ void RootFileWriter::finalizeRootFile() {
 
     // Write and clear magnet 1D hists
     for (auto it : magnet_edep) {
-        it->Write();
+        WriteObject(it);
         delete it;
     }
     magnet_edep.clear();
 
     for (auto mag : magnet_exit_Rpos) {
         for (auto PDG : mag) {
-            PDG.second->Write();
+            WriteObject(PDG.second);
             delete PDG.second;
         }
         mag.clear();
@@ -1862,7 +2555,7 @@ void RootFileWriter::finalizeRootFile() {
 
     for (auto mag : magnet_exit_Rpos_cutoff) {
         for (auto PDG : mag) {
-            PDG.second->Write();
+            WriteObject(PDG.second);
             delete PDG.second;
         }
         mag.clear();
@@ -1871,7 +2564,7 @@ void RootFileWriter::finalizeRootFile() {
 
     for (auto mag : magnet_exit_energy) {
         for (auto PDG : mag) {
-            PDG.second->Write();
+            WriteObject(PDG.second);
             delete PDG.second;
         }
         mag.clear();
@@ -1880,7 +2573,7 @@ void RootFileWriter::finalizeRootFile() {
 
     for (auto mag : magnet_exit_cutoff_energy) {
         for (auto PDG : mag) {
-            PDG.second->Write();
+            WriteObject(PDG.second);
             delete PDG.second;
         }
         mag.clear();
@@ -1959,67 +2652,315 @@ void RootFileWriter::finalizeRootFile() {
         }
     }
 
-    histFile->Write();
+    CloseRootFile();
+}
+
+void RootFileWriter::CloseRootFile() {
+    WriteManifest();
+
+    // All objects have been written explicitly, so there is no histFile->Write() here;
+    // it would serialize anything still attached to the directory a second time.
     histFile->Close();
     delete histFile; histFile = NULL;
     G4cout << "Results written to ROOT file '" + rootFileName +"'." << G4endl;
     G4cout << G4endl;
+    WriteProgress("done");
+
+    // The final results are now in the ROOT file
+    if (liveSnapshotTime > 0.0 and access(liveSnapshotFileName.c_str(), F_OK) == 0) {
+        if (remove(liveSnapshotFileName.c_str()) != 0) {
+            perror("Error removing live snapshot file");
+        }
+    }
+
+    // The run completed, so the checkpoint is no longer needed
+    G4bool interrupted = (stopReason == STOP_WALLTIME or stopReason == STOP_SIGNAL);
+    if ( (checkpointEvents > 0 or checkpointTime > 0.0 or resume) and not interrupted and
+         access(checkpointFileName.c_str(), F_OK) == 0 ) {
+        if (remove(checkpointFileName.c_str()) != 0) {
+            perror("Error removing checkpoint file");
+        }
+        else {
+            G4cout << "Removed checkpoint file '" << checkpointFileName << "'." << G4endl << G4endl;
+        }
+    }
+}
+
+void RootFileWriter::InitializeStatsOnly() {
+    // Only the scalar accumulators are kept: Phase space moments, particle type counts,
+    // target exit angle sums, and energy deposit sums. No histograms or TTrees.
+    // These are filled by doEvent(), which skips the histograms in statsOnly mode.
+    G4RunManager*                      run    = G4RunManager::GetRunManager();
+    DetectorConstruction*              detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+    VirtualTrackerWorldConstruction*   traCon = VirtualTrackerWorldConstruction::getInstance();
+
+    G4cout << "Running in statsOnly mode -- only writing Twiss parameters, moments, particle types and sums." << G4endl;
+    if (chunkEvents > 0 or chunkSizeMB > 0.0 or recordRNG != "" or anaScatterTest) {
+        G4cout << "Note: The TTree options and anaScatterTest have no effect in statsOnly mode." << G4endl;
+    }
+    miniFile = true;
+
+    auto newPhaseSpace = [this](G4String name, G4String title) {
+        return NewPhaseSpace(name.c_str(), title.c_str(),
+                             1000, -phasespacehist_posLim/mm,phasespacehist_posLim/mm,
+                             1000, -phasespacehist_angLim/rad,phasespacehist_angLim/rad);
+    };
+    const std::vector<std::pair<G4int,G4String>> PDGclasses =
+        { {11,"electrons"}, {-11,"positrons"}, {22,"photons"}, {2212,"protons"}, {0,"other"} };
+    auto newPhaseSpacePDG = [&](G4String baseName, G4String xy) {
+        std::map<G4int,phaseSpaceAccumulator*> phaseSpaces;
+        for (auto PDGclass : PDGclasses) {
+            G4String PDGname = (PDGclass.first == 0) ? G4String("other") : G4String(std::to_string(PDGclass.first));
+            phaseSpaces[PDGclass.first] =
+                newPhaseSpace(baseName+"_cutoff_"+xy+"_PDG"+PDGname,
+                              baseName+" phase space ("+xy+") ("+PDGclass.second+", energy > Ecut, r < Rcut)");
+        }
+        return phaseSpaces;
+    };
+
+    init_phasespaceX = newPhaseSpace("init_x", "Initial phase space (x)");
+    init_phasespaceY = newPhaseSpace("init_y", "Initial phase space (y)");
+
+    if (detCon->GetHasTarget()) {
+        target_exit_phasespaceX        = newPhaseSpace("target_exit_x", "Target exit phase space (x)");
+        target_exit_phasespaceY        = newPhaseSpace("target_exit_y", "Target exit phase space (y)");
+        target_exit_phasespaceX_cutoff = newPhaseSpace("target_exit_cutoff_x",
+                                                       "Target exit phase space (x) (charged, energy > Ecut, r < Rcut)");
+        target_exit_phasespaceY_cutoff = newPhaseSpace("target_exit_cutoff_y",
+                                                       "Target exit phase space (y) (charged, energy > Ecut, r < Rcut)");
+
+        typeCounter["target"]        = particleTypesCounter();
+        typeCounter["target_cutoff"] = particleTypesCounter();
+
+        target_exitangle              = 0.0;
+        target_exitangle2             = 0.0;
+        target_exitangle_numparticles = 0;
+        target_exitangle_cutoff              = 0.0;
+        target_exitangle2_cutoff             = 0.0;
+        target_exitangle_cutoff_numparticles = 0;
+
+        target_edep_sum  = 0.0;
+        target_edep_sum2 = 0.0;
+    }
+
+    for (int idx = 0; idx < traCon->getNumTrackers(); idx++) {
+        G4String trackerName;
+        if (traCon->getNumTrackers() == 1) { trackerName = "tracker"; }
+        else                               { trackerName = std::string("tracker_") + std::to_string(idx+1); }
+
+        tracker_phasespaceX.push_back(newPhaseSpace(trackerName+"_x", trackerName+" phase space (x)"));
+        tracker_phasespaceY.push_back(newPhaseSpace(trackerName+"_y", trackerName+" phase space (y)"));
+        tracker_phasespaceX_cutoff.push_back(newPhaseSpace(trackerName+"_cutoff_x",
+                                                           trackerName+" phase space (x) (charged, energy > Ecut, r < Rcut)"));
+        tracker_phasespaceY_cutoff.push_back(newPhaseSpace(trackerName+"_cutoff_y",
+                                                           trackerName+" phase space (y) (charged, energy > Ecut, r < Rcut)"));
+        tracker_phasespaceX_cutoff_PDG.push_back(newPhaseSpacePDG(trackerName, "x"));
+        tracker_phasespaceY_cutoff_PDG.push_back(newPhaseSpacePDG(trackerName, "y"));
+
+        typeCounter[trackerName]             = particleTypesCounter();
+        typeCounter[trackerName + "_cutoff"] = particleTypesCounter();
+    }
+
+    magnet_edep_sum.clear();
+    magnet_edep_sum2.clear();
+    for (auto mag : detCon->magnets) {
+        const G4String magName = mag->magnetName;
+
+        magnet_exit_phasespaceX.push_back(newPhaseSpace(magName+"_x", magName+" phase space (x)"));
+        magnet_exit_phasespaceY.push_back(newPhaseSpace(magName+"_y", magName+" phase space (y)"));
+        magnet_exit_phasespaceX_cutoff.push_back(newPhaseSpace(magName+"_cutoff_x",
+                                                               magName+" phase space (x) (charged, energy > Ecut, r < Rcut)"));
+        magnet_exit_phasespaceY_cutoff.push_back(newPhaseSpace(magName+"_cutoff_y",
+                                                               magName+" phase space (y) (charged, energy > Ecut, r < Rcut)"));
+        magnet_exit_phasespaceX_cutoff_PDG.push_back(newPhaseSpacePDG(magName, "x"));
+        magnet_exit_phasespaceY_cutoff_PDG.push_back(newPhaseSpacePDG(magName, "y"));
+
+        typeCounter[magName]             = particleTypesCounter();
+        typeCounter[magName + "_cutoff"] = particleTypesCounter();
+
+        magnet_edep_sum.push_back(0.0);
+        magnet_edep_sum2.push_back(0.0);
+    }
+}
+
+void RootFileWriter::FinalizeStatsOnly() {
+    G4RunManager*         run    = G4RunManager::GetRunManager();
+    DetectorConstruction* detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+
+    // Energy deposit per event: [numEvents, sum, sum of squares] [MeV]
+    G4cout << "** Energy deposits **" << G4endl;
+    if (detCon->GetHasTarget()) {
+        G4cout << "target : average = " << target_edep_sum/eventCounter << " [MeV/event]" << G4endl;
+        TVectorD edepVector(3);
+        edepVector[0] = double(eventCounter);
+        edepVector[1] = target_edep_sum;
+        edepVector[2] = target_edep_sum2;
+        WriteObject(&edepVector, "target_edepStats");
+    }
+    for (size_t magIdx = 0; magIdx < detCon->magnets.size(); magIdx++) {
+        const G4String magName = detCon->magnets[magIdx]->magnetName;
+        G4cout << magName << " : average = " << magnet_edep_sum[magIdx]/eventCounter << " [MeV/event]" << G4endl;
+        TVectorD edepVector(3);
+        edepVector[0] = double(eventCounter);
+        edepVector[1] = magnet_edep_sum[magIdx];
+        edepVector[2] = magnet_edep_sum2[magIdx];
+        WriteObject(&edepVector, (magName+"_edepStats").c_str());
+    }
+    G4cout << G4endl;
+
+    // Clean up the accumulators
+    delete init_phasespaceX; init_phasespaceX = NULL;
+    delete init_phasespaceY; init_phasespaceY = NULL;
+
+    delete target_exit_phasespaceX;        target_exit_phasespaceX        = NULL;
+    delete target_exit_phasespaceY;        target_exit_phasespaceY        = NULL;
+    delete target_exit_phasespaceX_cutoff; target_exit_phasespaceX_cutoff = NULL;
+    delete target_exit_phasespaceY_cutoff; target_exit_phasespaceY_cutoff = NULL;
+
+    for (auto phaseSpaces : {&tracker_phasespaceX, &tracker_phasespaceY,
+                             &tracker_phasespaceX_cutoff, &tracker_phasespaceY_cutoff,
+                             &magnet_exit_phasespaceX, &magnet_exit_phasespaceY,
+                             &magnet_exit_phasespaceX_cutoff, &magnet_exit_phasespaceY_cutoff}) {
+        for (auto it : *phaseSpaces) {
+            delete it;
+        }
+        phaseSpaces->clear();
+    }
+    for (auto phaseSpaces : {&tracker_phasespaceX_cutoff_PDG, &tracker_phasespaceY_cutoff_PDG,
+                             &magnet_exit_phasespaceX_cutoff_PDG, &magnet_exit_phasespaceY_cutoff_PDG}) {
+        for (auto plane : *phaseSpaces) {
+            for (auto PDG : plane) {
+                delete PDG.second;
+            }
+        }
+        phaseSpaces->clear();
+    }
+    magnet_edep_sum.clear();
+    magnet_edep_sum2.clear();
 }
 
-void RootFileWriter::PrintTwissParameters(TH2D* phaseSpaceHist) {
-    G4cout << "Stats for '" << phaseSpaceHist->GetTitle() << "':"  << G4endl;
-    double stats[7];
-    phaseSpaceHist->GetStats(stats);
-    /* From docs: https://root.cern.ch/doc/master/classTH2.html#a7836d201c7ab24717a65a38779d2f243
-     * Note: Here all weights = 1
-     * stats[0] = sumw    (number of fills)
-     * stats[1] = sumw2   (number of fills 1^1 = 1)
-     * stats[2] = sumwx   (sum of X in fills)
-     * stats[3] = sumwx2  (sum of X^2 in fills)
-     * stats[4] = sumwy   (sum of Y^2 in fills)
-     * stats[5] = sumwy2  (sum of Y^2 in fills)
-     * stats[6] = sumwxy  (sum of X*Y in fills)
-     */
-
-    // Fill used [mm] and [rad].
-    // These variance formulas are susceptible to catastrophic cancellation if mean far off-center compared to sigma,
-    // but mean should be close to zero so we should be OK
-    double posAve   = stats[2]/stats[0];
-    double angAve   = stats[4]/stats[0];
-    double posVar   = (stats[3] - stats[2]*stats[2]/stats[0]) / (stats[0]-1.0) ;
-    double angVar   = (stats[5] - stats[4]*stats[4]/stats[0]) / (stats[0]-1.0) ;
-    double coVar    = (stats[6] - stats[2]*stats[4]/stats[0]) / (stats[0]-1.0);
-
-    G4cout << "numHits = "  << stats[0]
-           << ", posAve = " << posAve     << " [mm]"
-           << ", angAve = " << angAve     << " [rad]"
-           << ", posVar = " << posVar     << " [mm^2]"
-           << ", angVar = " << angVar     << " [rad^2]"
-           << ", coVar  = " << coVar      << " [rad*mm]"
+phaseSpaceAccumulator* RootFileWriter::NewPhaseSpace(const char* name, const char* title,
+                                                     Int_t nbinsx, Double_t xlow, Double_t xup,
+                                                     Int_t nbinsy, Double_t ylow, Double_t yup) {
+    phaseSpaceAccumulator* phaseSpace = new phaseSpaceAccumulator();
+    phaseSpace->name  = name;
+    phaseSpace->title = title;
+    // The histograms are only used for output, which is skipped in quickmode
+    if (not quickmode and not statsOnly) {
+        phaseSpace->hist = new TH2D(name, title, nbinsx, xlow, xup, nbinsy, ylow, yup);
+        phaseSpace->warmupSize = autoRange;
+    }
+    return phaseSpace;
+}
+
+void phaseSpaceAccumulator::EndWarmup() {
+    if (warmupSize == 0) return;
+    warmupSize = 0;
+    if (warmup.empty()) return; // Keep the default ranges
+
+    // Robust range of one variable: The quantiles [q, 1-q], plus a margin.
+    // Falls back to the current range if all the hits have (nearly) the same value.
+    auto getRange = [&](std::vector<G4double>& vals, TAxis* axis, G4double& vMin, G4double& vMax) {
+        const size_t n = vals.size();
+        const size_t iLow  = size_t(autoRange_quantile*(n-1));
+        const size_t iHigh = n-1 - iLow;
+        std::nth_element(vals.begin(), vals.begin()+iLow,  vals.end());
+        const G4double qLow  = vals[iLow];
+        std::nth_element(vals.begin(), vals.begin()+iHigh, vals.end());
+        const G4double qHigh = vals[iHigh];
+        const G4double width = qHigh - qLow;
+        if (not (width > 1e-9*std::max(std::fabs(qLow),std::fabs(qHigh))) or not std::isfinite(width)) {
+            vMin = axis->GetXmin();
+            vMax = axis->GetXmax();
+            return;
+        }
+        vMin = qLow  - autoRange_margin*width;
+        vMax = qHigh + autoRange_margin*width;
+    };
+    std::vector<G4double> pos, ang;
+    pos.reserve(warmup.size());
+    ang.reserve(warmup.size());
+    for (auto& hit : warmup) {
+        pos.push_back(hit.first);
+        ang.push_back(hit.second);
+    }
+    G4double posMin, posMax, angMin, angMax;
+    getRange(pos, hist->GetXaxis(), posMin, posMax);
+    getRange(ang, hist->GetYaxis(), angMin, angMax);
+
+    std::vector<std::pair<G4double,G4double>> buffered;
+    buffered.swap(warmup);
+    SetRange(posMin, posMax, angMin, angMax);
+    numWarmupHits = buffered.size();
+    for (auto& hit : buffered) {
+        hist->Fill(hit.first, hit.second);
+    }
+}
+
+void phaseSpaceAccumulator::SetRange(G4double posMin, G4double posMax, G4double angMin, G4double angMax) {
+    hist->SetBins(hist->GetNbinsX(), posMin, posMax, hist->GetNbinsY(), angMin, angMax);
+    warmupSize = 0;
+    warmup.clear();
+    warmup.shrink_to_fit();
+    autoRanged = true;
+}
+
+void RootFileWriter::PrintTwissParameters(phaseSpaceAccumulator* phaseSpace) {
+    G4cout << "Stats for '" << phaseSpace->title << "':"  << G4endl;
+
+    const MomentAccumulator2D& moments = phaseSpace->moments;
+    TVectorD twissVector = GetTwissVector(moments);
+
+    G4cout << "numHits = "  << double(moments.GetN())
+           << ", posAve = " << twissVector[3] << " [mm]"
+           << ", angAve = " << twissVector[4] << " [rad]"
+           << ", posVar = " << twissVector[5] << " [mm^2]"
+           << ", angVar = " << twissVector[6] << " [rad^2]"
+           << ", coVar  = " << twissVector[7] << " [rad*mm]"
            << G4endl;
 
     G4RunManager*           run    = G4RunManager::GetRunManager();
     PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
-    double gamma_rel = 1 + ( genAct->get_beam_energy() * MeV / genAct->get_beam_particlemass() );
-    double beta_rel = sqrt(gamma_rel*gamma_rel - 1.0) / gamma_rel;
-
-    double det = posVar*angVar - coVar*coVar; // [mm^2 * rad^2]
-    double epsG = sqrt(det);                  // [mm*rad]
-    double epsN = epsG*beta_rel*gamma_rel;    // [mm*rad]
-    double beta = posVar/epsG;                // [mm]
-    double alpha = -coVar/epsG;               // [-]
+    double epsG = sqrt(twissVector[5]*twissVector[6] - twissVector[7]*twissVector[7]); // [mm*rad]
 
     G4cout << "Geometrical emittance          = " << epsG*1e3 << " [um = mm*mrad]" << G4endl;
-    G4cout << "Normalized emittance           = " << epsN*1e3 << " [um = mm*mrad]"
+    G4cout << "Normalized emittance           = " << twissVector[0] << " [um = mm*mrad]"
            << ", assuming beam kinetic energy = " << genAct->get_beam_energy() << " [MeV]"
            << ", and mass = " << genAct->get_beam_particlemass()/MeV << " [MeV/c^2]"
            << G4endl;
-    G4cout << "Twiss beta  = " << beta*1e-3  << " [m]" << G4endl
-           << "Twiss alpha = " << alpha      << " [-]"  << G4endl;
+    G4cout << "Twiss beta  = " << twissVector[1] << " [m]" << G4endl
+           << "Twiss alpha = " << twissVector[2] << " [-]"  << G4endl;
 
     G4cout << G4endl;
 
     // Write to root file
+    WriteObject(&twissVector, (phaseSpace->name+"_TWISS").c_str());
+
+    // Raw moments, so that results from several runs can be merged exactly
+    TVectorD momentsVector = moments.GetRawMoments();
+    WriteObject(&momentsVector, (phaseSpace->name+"_MOMENTS").c_str());
+}
+
+TVectorD RootFileWriter::GetTwissVector(const MomentAccumulator2D& moments) {
+    // Moments from the streaming accumulator, in [mm] and [rad].
+    // These are independent of the histogram binning and ranges, and numerically stable.
+    double posAve   = moments.GetMeanU();
+    double angAve   = moments.GetMeanV();
+    double posVar   = moments.GetVarU();
+    double angVar   = moments.GetVarV();
+    double coVar    = moments.GetCovUV();
+
+    G4RunManager*           run    = G4RunManager::GetRunManager();
+    PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
+    double gamma_rel = 1 + ( genAct->get_beam_energy() * MeV / genAct->get_beam_particlemass() );
+    double beta_rel = sqrt(gamma_rel*gamma_rel - 1.0) / gamma_rel;
+
+    double det = posVar*angVar - coVar*coVar; // [mm^2 * rad^2]
+    double epsG = sqrt(det);                  // [mm*rad]
+    double epsN = epsG*beta_rel*gamma_rel;    // [mm*rad]
+    double beta = posVar/epsG;                // [mm]
+    double alpha = -coVar/epsG;               // [-]
+
     TVectorD twissVector (8);
     twissVector[0] = epsN*1e3;  // [um = mm*mrad]
     twissVector[1] = beta*1e-3; // [m]
@@ -2029,7 +2970,759 @@ void RootFileWriter::PrintTwissParameters(TH2D* phaseSpaceHist) {
     twissVector[5] = posVar;    // [mm^2]
     twissVector[6] = angVar;    // [rad^2]
     twissVector[7] = coVar;     // [mm*rad]
-    twissVector.Write( (G4String(phaseSpaceHist->GetName())+"_TWISS").c_str() );
+    return twissVector;
+}
+
+std::vector<phaseSpaceAccumulator*> RootFileWriter::GetAllPhaseSpaces() {
+    std::vector<phaseSpaceAccumulator*> phaseSpaces;
+    for (auto ps : {init_phasespaceX, init_phasespaceY,
+                    target_exit_phasespaceX, target_exit_phasespaceY,
+                    target_exit_phasespaceX_cutoff, target_exit_phasespaceY_cutoff}) {
+        if (ps != NULL) phaseSpaces.push_back(ps);
+    }
+    for (auto psVector : {&tracker_phasespaceX, &tracker_phasespaceY,
+                          &tracker_phasespaceX_cutoff, &tracker_phasespaceY_cutoff,
+                          &magnet_exit_phasespaceX, &magnet_exit_phasespaceY,
+                          &magnet_exit_phasespaceX_cutoff, &magnet_exit_phasespaceY_cutoff}) {
+        phaseSpaces.insert(phaseSpaces.end(), psVector->begin(), psVector->end());
+    }
+    for (auto psMaps : {&tracker_phasespaceX_cutoff_PDG, &tracker_phasespaceY_cutoff_PDG,
+                        &magnet_exit_phasespaceX_cutoff_PDG, &magnet_exit_phasespaceY_cutoff_PDG}) {
+        for (auto& psMap : *psMaps) {
+            for (auto PDG : psMap) {
+                phaseSpaces.push_back(PDG.second);
+            }
+        }
+    }
+    return phaseSpaces;
+}
+
+void RootFileWriter::ConnectPrecisionMonitor() {
+    if (not precision.IsActive()) return;
+
+    std::vector<phaseSpaceAccumulator*> phaseSpaces = GetAllPhaseSpaces();
+    for (const G4String& name : precision.GetPhaseSpaceNames()) {
+        auto it = std::find_if(phaseSpaces.begin(), phaseSpaces.end(),
+                               [&name](phaseSpaceAccumulator* ps) { return ps->name == name; });
+        if (it == phaseSpaces.end()) {
+            G4cerr << "Error in precision target: unknown phase space '" << name << "'." << G4endl
+                   << "Available phase spaces:";
+            for (auto ps : phaseSpaces) {
+                G4cerr << " '" << ps->name << "'";
+            }
+            G4cerr << G4endl;
+            exit(1);
+        }
+        (*it)->batchMoments = precision.GetBatchMoments(name);
+    }
+    precision.Print();
+}
+
+G4bool RootFileWriter::StopRequested() {
+    if (stopReason != STOP_NONE) return true;
+
+    if (stopSignal != 0) {
+        stopReason = STOP_SIGNAL;
+        G4cout << "Received signal " << stopSignal << " (" << strsignal(stopSignal) << "),"
+               << " stopping the run after event " << eventCounter << G4endl;
+    }
+    else if (maxWallTime > 0.0) {
+        std::chrono::duration<double> wallTime = std::chrono::steady_clock::now() - wallTimeStart;
+        if (wallTime.count() >= maxWallTime) {
+            stopReason = STOP_WALLTIME;
+            G4cout << "Wall time " << wallTime.count() << " [s] exceeds maxWallTime = " << maxWallTime << " [s],"
+                   << " stopping the run after event " << eventCounter << G4endl;
+        }
+    }
+    if (stopReason == STOP_NONE and PrecisionReached()) {
+        stopReason = STOP_PRECISION;
+    }
+
+    return stopReason != STOP_NONE;
+}
+
+void RootFileWriter::HandleStopSignal(int signum) {
+    // Only set a flag here; the run is aborted after the current event (see EventAction),
+    // and the output file is written as usual.
+    // The default action is restored, so that a second signal terminates the program immediately.
+    stopSignal = signum;
+    signal(signum, SIG_DFL);
+}
+
+std::vector<TH1*> RootFileWriter::GetAllHistograms() {
+    // All the histograms that accumulate over the run (TH2D and TH3D are also TH1)
+    std::vector<TH1*> hists;
+    for (TH1* h : std::initializer_list<TH1*>
+             {targetEdep, targetEdep_NIEL, targetEdep_IEL,
+              target_exitangle_hist, target_exitangle_hist_cutoff,
+              target_exit_phasespaceXY, target_exit_phasespaceXY_cutoff,
+              target_edep_dens, target_edep_rdens,
+              init_phasespaceXY, init_E}) {
+        if (h != NULL) hists.push_back(h);
+    }
+    for (auto histMap : {&target_exit_energy, &target_exit_cutoff_energy,
+                         &target_exit_Rpos, &target_exit_Rpos_cutoff}) {
+        for (auto it : *histMap) {
+            hists.push_back(it.second);
+        }
+    }
+    for (auto histVector : {&magnet_edep, &tracker_numParticles, &tracker_energy}) {
+        for (auto h : *histVector) {
+            if (h != NULL) hists.push_back(h);
+        }
+    }
+    for (auto h : magnet_edep_dens) {
+        if (h != NULL) hists.push_back(h);
+    }
+    for (auto histVector : {&magnet_edep_rdens, &tracker_phasespaceXY, &tracker_phasespaceXY_cutoff}) {
+        for (auto h : *histVector) {
+            if (h != NULL) hists.push_back(h);
+        }
+    }
+    for (auto histMaps : {&magnet_exit_Rpos, &magnet_exit_Rpos_cutoff,
+                          &magnet_exit_energy, &magnet_exit_cutoff_energy,
+                          &tracker_type_energy, &tracker_type_cutoff_energy,
+                          &tracker_Rpos, &tracker_Rpos_cutoff}) {
+        for (auto& histMap : *histMaps) {
+            for (auto it : histMap) {
+                hists.push_back(it.second);
+            }
+        }
+    }
+    for (auto& histMap : tracker_phasespaceXY_cutoff_PDG) {
+        for (auto it : histMap) {
+            hists.push_back(it.second);
+        }
+    }
+    for (auto ps : GetAllPhaseSpaces()) {
+        if (ps->hist != NULL) hists.push_back(ps->hist);
+    }
+    return hists;
+}
+
+void RootFileWriter::WriteCheckpointIfDue() {
+    G4bool isDue = false;
+    if (checkpointEvents > 0 and eventCounter % checkpointEvents == 0) {
+        isDue = true;
+    }
+    if (checkpointTime > 0.0) {
+        std::chrono::duration<double> sinceLast = std::chrono::steady_clock::now() - lastCheckpointTime;
+        if (sinceLast.count() >= checkpointTime) {
+            isDue = true;
+        }
+    }
+    if (isDue) {
+        WriteCheckpoint();
+        lastCheckpointTime = std::chrono::steady_clock::now();
+    }
+}
+
+void RootFileWriter::WriteCheckpoint() {
+    // Everything needed to continue the run as if it was never interrupted:
+    // The accumulated histograms, moments and counters, and the state of all the RNGs.
+    G4RunManager*           run    = G4RunManager::GetRunManager();
+    DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+    PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
+
+    // Close the current TTree chunk, so that all the TTree entries up to now are safely on disk,
+    // and a resumed run never finds entries from after the checkpoint in an open chunk.
+    // The next event opens a new chunk, so the chunks also end at the checkpoints (documented in -h).
+    if (chunkFile != NULL) {
+        CloseChunkFile();
+    }
+
+    // Write to a temporary file first, then rename it into place (atomic on POSIX),
+    // so that a crash while writing leaves the previous checkpoint intact.
+    G4String tmpName = checkpointFileName + ".tmp";
+    TFile* checkpointFile = new TFile(tmpName, "RECREATE");
+    if ( not checkpointFile->IsOpen() ) {
+        G4cerr << "Opening checkpoint file '" << tmpName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+
+    TObjString featuresString(GetCheckpointFeatures().c_str());
+    checkpointFile->WriteTObject(&featuresString, "checkpoint_features");
+
+    // Scalar sums: [eventCounter, exit angle sums and counts (target), exit angle sums and counts (target cutoff)],
+    // with each compensated sum stored as (sum, compensation) so that the resumed run adds up identically
+    TVectorD scalarsVector(11);
+    scalarsVector[0] = double(eventCounter);
+    if (detCon->GetHasTarget()) {
+        scalarsVector[1]  = target_exitangle.GetSum();
+        scalarsVector[2]  = target_exitangle.GetComp();
+        scalarsVector[3]  = target_exitangle2.GetSum();
+        scalarsVector[4]  = target_exitangle2.GetComp();
+        scalarsVector[5]  = double(target_exitangle_numparticles);
+        scalarsVector[6]  = target_exitangle_cutoff.GetSum();
+        scalarsVector[7]  = target_exitangle_cutoff.GetComp();
+        scalarsVector[8]  = target_exitangle2_cutoff.GetSum();
+        scalarsVector[9]  = target_exitangle2_cutoff.GetComp();
+        scalarsVector[10] = double(target_exitangle_cutoff_numparticles);
+    }
+    checkpointFile->WriteTObject(&scalarsVector, "checkpoint_scalars");
+
+    if (statsOnly) {
+        // [target sum, target sum2, (sum, sum2) per magnet] [MeV],
+        // each as (sum, compensation)
+        TVectorD edepVector(4 + 4*magnet_edep_sum.size());
+        if (detCon->GetHasTarget()) {
+            edepVector[0] = target_edep_sum.GetSum();
+            edepVector[1] = target_edep_sum.GetComp();
+            edepVector[2] = target_edep_sum2.GetSum();
+            edepVector[3] = target_edep_sum2.GetComp();
+        }
+        for (size_t magIdx = 0; magIdx < magnet_edep_sum.size(); magIdx++) {
+            edepVector[4+4*magIdx]   = magnet_edep_sum[magIdx].GetSum();
+            edepVector[4+4*magIdx+1] = magnet_edep_sum[magIdx].GetComp();
+            edepVector[4+4*magIdx+2] = magnet_edep_sum2[magIdx].GetSum();
+            edepVector[4+4*magIdx+3] = magnet_edep_sum2[magIdx].GetComp();
+        }
+        checkpointFile->WriteTObject(&edepVector, "checkpoint_edepSums");
+    }
+
+    if (not hitTreeStats.empty()) {
+        // [numHits, numTriggerFailed, numPassed, numStored] per plane
+        TVectorD hitTreeStatsVector(4*hitTreeStats.size());
+        for (size_t planeIdx = 0; planeIdx < hitTreeStats.size(); planeIdx++) {
+            hitTreeStatsVector[4*planeIdx]   = double(hitTreeStats[planeIdx].numHits);
+            hitTreeStatsVector[4*planeIdx+1] = double(hitTreeStats[planeIdx].numTriggerFailed);
+            hitTreeStatsVector[4*planeIdx+2] = double(hitTreeStats[planeIdx].numPassed);
+            hitTreeStatsVector[4*planeIdx+3] = double(hitTreeStats[planeIdx].numStored);
+        }
+        checkpointFile->WriteTObject(&hitTreeStatsVector, "checkpoint_hitTreeStats");
+    }
+
+    if (eventTrigger.IsActive()) {
+        TVectorD triggerVector(2);
+        triggerVector[0] = double(eventTrigger.GetNumEvaluated());
+        triggerVector[1] = double(eventTrigger.GetNumPassed());
+        checkpointFile->WriteTObject(&triggerVector, "checkpoint_eventTrigger");
+    }
+
+    if (chunkEvents > 0 or chunkSizeMB > 0.0) {
+        // [firstEvent, lastEvent, TargetExit entries, TrackerHits entries, magnetEdeps entries] per closed chunk
+        TVectorD chunkIndexVector(5*chunkIndex.size());
+        for (size_t i = 0; i < chunkIndex.size(); i++) {
+            chunkIndexVector[5*i]   = double(chunkIndex[i].firstEvent);
+            chunkIndexVector[5*i+1] = double(chunkIndex[i].lastEvent);
+            chunkIndexVector[5*i+2] = double(chunkIndex[i].targetExitEntries);
+            chunkIndexVector[5*i+3] = double(chunkIndex[i].trackerHitsEntries);
+            chunkIndexVector[5*i+4] = double(chunkIndex[i].magnetEdepsEntries);
+        }
+        checkpointFile->WriteTObject(&chunkIndexVector, "checkpoint_chunkIndex");
+    }
+
+    if (precision.IsActive()) {
+        TVectorD precisionVector = precision.GetState();
+        checkpointFile->WriteTObject(&precisionVector, "checkpoint_precision");
+    }
+
+    // The counters of the optional features, as written in finalizeRootFile()
+    for (auto& it : RunCounters::GetAll()) {
+        const std::vector<G4double>& values = it.second.GetValues();
+        TVectorD countersVector(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            countersVector[i] = values[i];
+        }
+        checkpointFile->WriteTObject(&countersVector, ("checkpoint_" + it.first).c_str());
+    }
+
+    if (planeScorer != NULL) {
+        TMatrixD planesState = planeScorer->GetState();
+        checkpointFile->WriteTObject(&planesState, "checkpoint_planes");
+    }
+
+    if (eventRNG != NULL) {
+        // The eventRNG TTree is not chunked, so the entries so far are stored in the checkpoint
+        checkpointFile->cd();
+        TTree* eventRNGCopy = eventRNG->CloneTree(-1);
+        eventRNGCopy->Write("checkpoint_eventRNG");
+        delete eventRNGCopy;
+    }
+
+    // Particle types: [numParticles, (PDG, count) per type], and the names in the same order
+    for (auto& it : typeCounter) {
+        TVectorD typesVector(1 + 2*it.second.particleTypes.size());
+        G4String typeNames = "";
+        typesVector[0] = double(it.second.numParticles);
+        G4int idx = 1;
+        for (auto type : it.second.particleTypes) {
+            typesVector[idx++] = double(type.first);
+            typesVector[idx++] = double(type.second);
+            typeNames += it.second.particleNames[type.first] + " ";
+        }
+        checkpointFile->WriteTObject(&typesVector, (it.first+"_TYPECOUNT").c_str());
+        TObjString typeNamesString(typeNames.c_str());
+        checkpointFile->WriteTObject(&typeNamesString, (it.first+"_TYPENAMES").c_str());
+    }
+
+    for (auto ps : GetAllPhaseSpaces()) {
+        TVectorD momentsVector = ps->moments.GetRawMoments();
+        checkpointFile->WriteTObject(&momentsVector, (ps->name+"_MOMENTS").c_str());
+
+        if (autoRange > 0 and ps->hist != NULL) {
+            // --autoRange state: [warmupSize, numWarmupHits, autoRanged, (pos, ang) per buffered hit],
+            // so that the ranges do not depend on when the checkpoints were written
+            TVectorD warmupVector(3 + 2*ps->warmup.size());
+            warmupVector[0] = double(ps->warmupSize);
+            warmupVector[1] = double(ps->numWarmupHits);
+            warmupVector[2] = ps->autoRanged ? 1.0 : 0.0;
+            for (size_t i = 0; i < ps->warmup.size(); i++) {
+                warmupVector[3+2*i]   = ps->warmup[i].first;
+                warmupVector[3+2*i+1] = ps->warmup[i].second;
+            }
+            checkpointFile->WriteTObject(&warmupVector, (ps->name+"_WARMUP").c_str());
+        }
+    }
+
+    for (auto hist : GetAllHistograms()) {
+        checkpointFile->WriteTObject(hist);
+    }
+
+    // RNG states
+    checkpointFile->WriteTObject(RNG, "RNG_RootFileWriter");
+    if (reservoirRNG != NULL) {
+        checkpointFile->WriteTObject(reservoirRNG, "RNG_treeReservoir");
+    }
+    if (genAct->GetRNG() != NULL) {
+        checkpointFile->WriteTObject(genAct->GetRNG(), "RNG_PrimaryGeneratorAction");
+    }
+    std::ostringstream engineState;
+    G4Random::saveFullState(engineState);
+    TObjString engineStateString(engineState.str().c_str());
+    checkpointFile->WriteTObject(&engineStateString, "RNG_Geant4");
+
+    checkpointFile->Close();
+    delete checkpointFile;
+    histFile->cd();
+
+    if (rename(tmpName.c_str(), checkpointFileName.c_str()) != 0) {
+        perror("Error renaming checkpoint file");
+        exit(1);
+    }
+    G4cout << "Wrote checkpoint after event " << eventCounter << G4endl;
+}
+
+G4String RootFileWriter::GetCheckpointFeatures() {
+    // The optional parts of the checkpoint, which must match between the checkpoint and the resumed run
+    G4String features = "";
+    if (statsOnly)                                          features += "statsOnly ";
+    if (eventTrigger.IsActive())                            features += "trigger ";
+    if (chunkEvents > 0 or chunkSizeMB > 0.0)               features += "chunks ";
+    if (precision.IsActive())                               features += "precision ";
+    if (eventRNG != NULL)                                   features += "eventRNG ";
+    if (autoRange > 0 and not quickmode and not statsOnly)  features += "autoRange ";
+    if (planeScorer != NULL)                                features += "scorePlanes ";
+    for (auto& it : RunCounters::GetAll())                  features += it.first + " ";
+    return features;
+}
+
+void RootFileWriter::ReadCheckpoint() {
+    G4RunManager*           run    = G4RunManager::GetRunManager();
+    DetectorConstruction*   detCon = (DetectorConstruction*)run->GetUserDetectorConstruction();
+    PrimaryGeneratorAction* genAct = (PrimaryGeneratorAction*)run->GetUserPrimaryGeneratorAction();
+
+    G4cout << "Resuming from checkpoint file '" << checkpointFileName << "'" << G4endl;
+    TFile* checkpointFile = new TFile(checkpointFileName, "READ");
+    if ( not checkpointFile->IsOpen() ) {
+        G4cerr << "Opening checkpoint file '" << checkpointFileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    // Everything in the checkpoint must exist, else the checkpoint is from a different setup
+    auto getObject = [&](G4String name) -> TObject* {
+        TObject* obj = checkpointFile->Get(name.c_str());
+        if (obj == NULL) {
+            G4cerr << "Error when reading checkpoint: '" << name << "' not found." << G4endl
+                   << "Was the checkpoint written with the same geometry and options?" << G4endl;
+            exit(1);
+        }
+        return obj;
+    };
+
+    // The state of all the active features must be in the checkpoint
+    TObjString* featuresString = (TObjString*) getObject("checkpoint_features");
+    if (featuresString->GetString() != GetCheckpointFeatures().c_str()) {
+        G4cerr << "Error when reading checkpoint: The checkpoint has the state of the features '"
+               << featuresString->GetString() << "'," << G4endl
+               << " but this run uses '" << GetCheckpointFeatures() << "'." << G4endl
+               << "Was the checkpoint written with the same geometry and options?" << G4endl;
+        exit(1);
+    }
+    delete featuresString;
+
+    TVectorD* scalarsVector = (TVectorD*) getObject("checkpoint_scalars");
+    if (scalarsVector->GetNrows() != 11) {
+        G4cerr << "Error when reading checkpoint: Wrong size of 'checkpoint_scalars'." << G4endl;
+        exit(1);
+    }
+    eventCounter = Long64_t((*scalarsVector)[0]);
+    resumedEvents = eventCounter;
+    if (detCon->GetHasTarget()) {
+        target_exitangle.Set        ((*scalarsVector)[1], (*scalarsVector)[2]);
+        target_exitangle2.Set       ((*scalarsVector)[3], (*scalarsVector)[4]);
+        target_exitangle_numparticles        = Long64_t((*scalarsVector)[5]);
+        target_exitangle_cutoff.Set ((*scalarsVector)[6], (*scalarsVector)[7]);
+        target_exitangle2_cutoff.Set((*scalarsVector)[8], (*scalarsVector)[9]);
+        target_exitangle_cutoff_numparticles = Long64_t((*scalarsVector)[10]);
+    }
+    delete scalarsVector;
+
+    if (statsOnly) {
+        TVectorD* edepVector = (TVectorD*) getObject("checkpoint_edepSums");
+        if (edepVector->GetNrows() != G4int(4 + 4*magnet_edep_sum.size())) {
+            G4cerr << "Error when reading checkpoint: Wrong number of magnets in 'checkpoint_edepSums'." << G4endl;
+            exit(1);
+        }
+        if (detCon->GetHasTarget()) {
+            target_edep_sum.Set ((*edepVector)[0], (*edepVector)[1]);
+            target_edep_sum2.Set((*edepVector)[2], (*edepVector)[3]);
+        }
+        for (size_t magIdx = 0; magIdx < magnet_edep_sum.size(); magIdx++) {
+            magnet_edep_sum[magIdx].Set ((*edepVector)[4+4*magIdx],   (*edepVector)[4+4*magIdx+1]);
+            magnet_edep_sum2[magIdx].Set((*edepVector)[4+4*magIdx+2], (*edepVector)[4+4*magIdx+3]);
+        }
+        delete edepVector;
+    }
+
+    if (not hitTreeStats.empty()) {
+        TVectorD* hitTreeStatsVector = (TVectorD*) getObject("checkpoint_hitTreeStats");
+        if (hitTreeStatsVector->GetNrows() != G4int(4*hitTreeStats.size())) {
+            G4cerr << "Error when reading checkpoint: Wrong number of planes in 'checkpoint_hitTreeStats'." << G4endl;
+            exit(1);
+        }
+        for (size_t planeIdx = 0; planeIdx < hitTreeStats.size(); planeIdx++) {
+            hitTreeStats[planeIdx].numHits          = Long64_t((*hitTreeStatsVector)[4*planeIdx]);
+            hitTreeStats[planeIdx].numTriggerFailed = Long64_t((*hitTreeStatsVector)[4*planeIdx+1]);
+            hitTreeStats[planeIdx].numPassed        = Long64_t((*hitTreeStatsVector)[4*planeIdx+2]);
+            hitTreeStats[planeIdx].numStored        = Long64_t((*hitTreeStatsVector)[4*planeIdx+3]);
+        }
+        delete hitTreeStatsVector;
+    }
+
+    if (eventTrigger.IsActive()) {
+        TVectorD* triggerVector = (TVectorD*) getObject("checkpoint_eventTrigger");
+        eventTrigger.SetCounters(G4long((*triggerVector)[0]), G4long((*triggerVector)[1]));
+        delete triggerVector;
+    }
+
+    if (precision.IsActive()) {
+        TVectorD* precisionVector = (TVectorD*) getObject("checkpoint_precision");
+        precision.SetState(*precisionVector);
+        delete precisionVector;
+    }
+
+    for (auto& it : RunCounters::GetAll()) {
+        TVectorD* countersVector = (TVectorD*) getObject("checkpoint_" + it.first);
+        std::vector<G4double> values(countersVector->GetNrows());
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i] = (*countersVector)[i];
+        }
+        it.second.SetValues(values);
+        delete countersVector;
+    }
+
+    if (planeScorer != NULL) {
+        TMatrixD* planesState = (TMatrixD*) getObject("checkpoint_planes");
+        planeScorer->SetState(*planesState);
+        delete planesState;
+    }
+
+    if (eventRNG != NULL) {
+        TTree* savedEventRNG = (TTree*) getObject("checkpoint_eventRNG");
+        eventRNG->CopyEntries(savedEventRNG);
+        delete savedEventRNG;
+    }
+
+    for (auto& it : typeCounter) {
+        TVectorD*   typesVector     = (TVectorD*)   getObject(it.first+"_TYPECOUNT");
+        TObjString* typeNamesString = (TObjString*) getObject(it.first+"_TYPENAMES");
+        std::istringstream typeNames(typeNamesString->GetString().Data());
+
+        it.second = particleTypesCounter();
+        it.second.numParticles = Long64_t((*typesVector)[0]);
+        for (G4int idx = 1; idx+1 < typesVector->GetNrows(); idx += 2) {
+            G4int PDG = G4int((*typesVector)[idx]);
+            std::string typeName;
+            typeNames >> typeName;
+            it.second.particleTypes[PDG] = Long64_t((*typesVector)[idx+1]);
+            it.second.particleNames[PDG] = typeName;
+        }
+        delete typesVector;
+        delete typeNamesString;
+
+        // The hit rates in the progress reports are for the hits after the checkpoint
+        lastProgressHits[it.first] = it.second.numParticles;
+    }
+
+    for (auto ps : GetAllPhaseSpaces()) {
+        TVectorD* momentsVector = (TVectorD*) getObject(ps->name+"_MOMENTS");
+        ps->moments.SetRawMoments(*momentsVector);
+        delete momentsVector;
+
+        if (autoRange > 0 and ps->hist != NULL) {
+            TVectorD* warmupVector = (TVectorD*) getObject(ps->name+"_WARMUP");
+            if ((*warmupVector)[0] > 0.0) {
+                // Still in the warm-up: Continue buffering
+                ps->warmup.clear();
+                for (G4int i = 3; i+1 < warmupVector->GetNrows(); i += 2) {
+                    ps->warmup.push_back(std::make_pair((*warmupVector)[i], (*warmupVector)[i+1]));
+                }
+            }
+            else if ((*warmupVector)[2] > 0.0) {
+                // Continue with the ranges chosen before the checkpoint
+                TH2D* savedHist = (TH2D*) getObject(ps->hist->GetName());
+                ps->SetRange(savedHist->GetXaxis()->GetXmin(), savedHist->GetXaxis()->GetXmax(),
+                             savedHist->GetYaxis()->GetXmin(), savedHist->GetYaxis()->GetXmax());
+                ps->numWarmupHits = size_t((*warmupVector)[1]);
+                delete savedHist;
+            }
+            else {
+                // The warm-up ended without hits, keeping the default ranges
+                ps->warmupSize = 0;
+            }
+            delete warmupVector;
+        }
+    }
+
+    for (auto hist : GetAllHistograms()) {
+        TH1* savedHist = (TH1*) getObject(hist->GetName());
+        hist->Reset();
+        hist->Add(savedHist);
+        delete savedHist;
+    }
+
+    // RNG states
+    delete RNG;
+    RNG = (TRandom*) getObject("RNG_RootFileWriter");
+    if (reservoirRNG != NULL) {
+        delete reservoirRNG;
+        reservoirRNG = (TRandom*) getObject("RNG_treeReservoir");
+    }
+    TRandom* genActRNG = (TRandom*) checkpointFile->Get("RNG_PrimaryGeneratorAction"); // NULL if not used
+    if (genActRNG != NULL) {
+        genAct->SetRNG(genActRNG);
+    }
+    TObjString* engineStateString = (TObjString*) getObject("RNG_Geant4");
+    std::istringstream engineState(engineStateString->GetString().Data());
+    G4Random::restoreFullState(engineState);
+    delete engineStateString;
+
+    checkpointFile->Close();
+    delete checkpointFile;
+    histFile->cd();
+
+    G4cout << "Resumed after event " << eventCounter << G4endl << G4endl;
+}
+
+void RootFileWriter::ReadCheckpointChunkIndex() {
+    TFile* checkpointFile = new TFile(checkpointFileName, "READ");
+    if ( not checkpointFile->IsOpen() ) {
+        G4cerr << "Opening checkpoint file '" << checkpointFileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    TVectorD* chunkIndexVector = (TVectorD*) checkpointFile->Get("checkpoint_chunkIndex");
+    if (chunkIndexVector == NULL) {
+        G4cerr << "Error when reading checkpoint: 'checkpoint_chunkIndex' not found." << G4endl
+               << "Was the checkpoint written with the same chunking options?" << G4endl;
+        exit(1);
+    }
+    for (G4int i = 0; i+4 < chunkIndexVector->GetNrows(); i += 5) {
+        chunkNumber++;
+        std::ostringstream chunkName;
+        chunkName << filename_out << "_chunk" << std::setw(4) << std::setfill('0') << chunkNumber << ".root";
+
+        chunkIndexEntry entry;
+        entry.fileName           = chunkName.str();
+        entry.firstEvent         = Long64_t((*chunkIndexVector)[i]);
+        entry.lastEvent          = Long64_t((*chunkIndexVector)[i+1]);
+        entry.targetExitEntries  = Long64_t((*chunkIndexVector)[i+2]);
+        entry.trackerHitsEntries = Long64_t((*chunkIndexVector)[i+3]);
+        entry.magnetEdepsEntries = Long64_t((*chunkIndexVector)[i+4]);
+        chunkIndex.push_back(entry);
+    }
+    delete chunkIndexVector;
+
+    checkpointFile->Close();
+    delete checkpointFile;
+    histFile->cd();
+}
+
+void RootFileWriter::WriteLiveSnapshotIfDue() {
+    // Snapshot of the results so far, for watching the run converge (e.g. from miniScatterDriver).
+    // Written at the end of an event, so it is always consistent;
+    // the objects have the same names and formats as in the final ROOT file.
+    if (liveSnapshotTime <= 0.0) return;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> sinceLast = now - lastLiveSnapshotTime;
+    if (sinceLast.count() < liveSnapshotTime) return;
+    lastLiveSnapshotTime = now;
+
+    // Write to a temporary file first, then rename it into place (atomic on POSIX),
+    // so that a reader never sees a partially written file.
+    G4String tmpName = liveSnapshotFileName + ".tmp";
+    TFile* snapshotFile = new TFile(tmpName, "RECREATE");
+    if ( not snapshotFile->IsOpen() ) {
+        G4cerr << "Opening live snapshot file '" << tmpName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+
+    // [eventCounter, numEvents, elapsed time [s]]
+    std::chrono::duration<double> runTime = now - runStartTime;
+    TVectorD progressVector(3);
+    progressVector[0] = double(eventCounter);
+    progressVector[1] = double(numEvents);
+    progressVector[2] = runTime.count();
+    snapshotFile->WriteTObject(&progressVector, "live_progress");
+
+    for (auto ps : GetAllPhaseSpaces()) {
+        if (ps->moments.GetN() < 2) continue;
+        TVectorD twissVector = GetTwissVector(ps->moments);
+        snapshotFile->WriteTObject(&twissVector, (ps->name+"_TWISS").c_str());
+        TVectorD momentsVector = ps->moments.GetRawMoments();
+        snapshotFile->WriteTObject(&momentsVector, (ps->name+"_MOMENTS").c_str());
+    }
+
+    for (auto& it : typeCounter) {
+        if (it.second.numParticles == 0) continue;
+        TVectorD particleTypes_PDG    (it.second.particleTypes.size());
+        TVectorD particleTypes_numpart(it.second.particleTypes.size());
+        size_t particleTypes_i = 0;
+        for (auto type : it.second.particleTypes) {
+            particleTypes_PDG    [particleTypes_i] = int(type.first);
+            particleTypes_numpart[particleTypes_i] = double(type.second);
+            particleTypes_i++;
+        }
+        snapshotFile->WriteTObject(&particleTypes_PDG,     (it.first + "_ParticleTypes_PDG").c_str());
+        snapshotFile->WriteTObject(&particleTypes_numpart, (it.first + "_ParticleTypes_numpart").c_str());
+    }
+
+    // A few 1D spectra (none in statsOnly mode)
+    for (TH1* h : std::initializer_list<TH1*> {init_E, targetEdep}) {
+        if (h != NULL) snapshotFile->WriteTObject(h);
+    }
+    for (auto histVector : {&tracker_energy, &magnet_edep}) {
+        for (auto h : *histVector) {
+            if (h != NULL) snapshotFile->WriteTObject(h);
+        }
+    }
+
+    snapshotFile->Close();
+    delete snapshotFile;
+    histFile->cd();
+
+    if (rename(tmpName.c_str(), liveSnapshotFileName.c_str()) != 0) {
+        perror("Error renaming live snapshot file");
+        exit(1);
+    }
+}
+
+void RootFileWriter::WriteProgressIfDue() {
+    if (progressFD < 0) return;
+    if (lastProgressEvents < 0) {
+        // First event of this run (which may be resumed from a checkpoint)
+        lastProgressEvents = eventCounter - 1;
+    }
+    std::chrono::duration<double> sinceLast = std::chrono::steady_clock::now() - lastProgressTime;
+    if (sinceLast.count() < progressInterval) return;
+    WriteProgress("running");
+}
+
+void RootFileWriter::WriteProgress(const char* status) {
+    // One JSON object per line, e.g.
+    // {"status":"running","events":1200,"numEvents":10000,"elapsed":2.5,"rate":480.1,"eta":18.3,
+    //  "rss_MB":153.2,"bufferedHits":0,"hits":{"target":1195,"target_cutoff":1003,...},
+    //  "hitRates":{"target":478.6,"target_cutoff":401.5,...}}
+    // rate is for the events since the last report [events/s]; eta [s] is -1 if unknown.
+    // hits are the totals for the run, and hitRates for the hits since the last report [hits/s].
+    if (progressFD < 0) return;
+
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::duration<double> runTime   = now - runStartTime;
+    std::chrono::duration<double> sinceLast = now - lastProgressTime;
+
+    G4double rate = 0.0;
+    if (sinceLast.count() > 0.0 and lastProgressEvents >= 0) {
+        rate = (eventCounter - lastProgressEvents) / sinceLast.count();
+    }
+    G4double eta = -1.0;
+    if (rate > 0.0 and numEvents > 0) {
+        eta = std::max(Long64_t(0), numEvents - eventCounter) / rate;
+    }
+    std::map<G4String,G4double> hitRates;
+    for (auto& it : typeCounter) {
+        hitRates[it.first] = 0.0;
+        if (sinceLast.count() > 0.0) {
+            hitRates[it.first] = (it.second.numParticles - lastProgressHits[it.first]) / sinceLast.count();
+        }
+        lastProgressHits[it.first] = it.second.numParticles;
+    }
+    lastProgressTime   = now;
+    lastProgressEvents = eventCounter;
+
+    // Resident set size, from the second field of /proc/self/statm [pages]
+    G4double rss_MB = -1.0;
+    std::ifstream statm("/proc/self/statm");
+    long pagesTotal, pagesResident;
+    if (statm >> pagesTotal >> pagesResident) {
+        rss_MB = pagesResident * double(sysconf(_SC_PAGESIZE)) / (1024.0*1024.0);
+    }
+
+    // Hits held in memory, waiting to be written to the TTrees
+    size_t bufferedHits = targetExitStaging.size();
+    for (auto& staging : trackerHitsStaging) {
+        bufferedHits += staging.size();
+    }
+    for (auto& stats : hitTreeStats) {
+        bufferedHits += stats.reservoir.size();
+    }
+
+    std::ostringstream progress;
+    progress << "{\"status\":\"" << status << "\""
+             << ",\"events\":"     << eventCounter
+             << ",\"numEvents\":"  << numEvents
+             << ",\"elapsed\":"    << runTime.count()
+             << ",\"rate\":"       << rate
+             << ",\"eta\":"        << eta
+             << ",\"rss_MB\":"     << rss_MB
+             << ",\"bufferedHits\":" << bufferedHits
+             << ",\"hits\":{";
+    G4bool first = true;
+    for (auto& it : typeCounter) {
+        progress << (first ? "" : ",") << "\"" << it.first << "\":" << it.second.numParticles;
+        first = false;
+    }
+    progress << "},\"hitRates\":{";
+    first = true;
+    for (auto& it : hitRates) {
+        progress << (first ? "" : ",") << "\"" << it.first << "\":" << it.second;
+        first = false;
+    }
+    progress << "}}" << std::endl;
+
+    const std::string line = progress.str();
+    if (write(progressFD, line.c_str(), line.size()) < 0) {
+        perror("Error writing progress report; disabling further reports");
+        progressFD = -1;
+    }
+}
+
+Long64_t RootFileWriter::GetCheckpointEventCounter() {
+    G4String fileName = foldername_out + "/" + filename_out + "_checkpoint.root";
+    TFile* checkpointFile = new TFile(fileName, "READ");
+    if ( not checkpointFile->IsOpen() ) {
+        G4cerr << "Opening checkpoint file '" << fileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    TVectorD* scalarsVector = (TVectorD*) checkpointFile->Get("checkpoint_scalars");
+    if (scalarsVector == NULL) {
+        G4cerr << "Error when reading checkpoint: 'checkpoint_scalars' not found." << G4endl;
+        exit(1);
+    }
+    Long64_t checkpointEventCounter = Long64_t((*scalarsVector)[0]);
+    delete scalarsVector;
+    checkpointFile->Close();
+    delete checkpointFile;
+    return checkpointEventCounter;
 }
 
 void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name) {
@@ -2045,7 +3738,7 @@ void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name)
     TVectorD particleTypes_numpart(pt.particleTypes.size());
 
     size_t particleTypes_i = 0;
-    for(std::map<G4int,G4int>::iterator it = pt.particleTypes.begin(); it != pt.particleTypes.end(); it++){
+    for(std::map<G4int,Long64_t>::iterator it = pt.particleTypes.begin(); it != pt.particleTypes.end(); it++){
         G4cout << std::setw(15) << it->first << " = "
                << std::setw(15) << pt.particleNames[it->first] << ": "
                << std::setw(15) << it->second << " = ";// << G4endl;
@@ -2057,15 +3750,67 @@ void RootFileWriter::PrintParticleTypes(particleTypesCounter& pt, G4String name)
         // Unfortunately, there is no TObject array type for ints (?!?),
         // and I don't want  to depend on a ROOT dictionary file.
         particleTypes_PDG     [particleTypes_i] = int(it->first);
-        particleTypes_numpart [particleTypes_i] = int(it->second);
+        particleTypes_numpart [particleTypes_i] = double(it->second);
 
         particleTypes_i++;
     }
-    particleTypes_PDG.Write((name + "_ParticleTypes_PDG").c_str());
-    particleTypes_numpart.Write((name + "_ParticleTypes_numpart").c_str());
+    WriteObject(&particleTypes_PDG, (name + "_ParticleTypes_PDG").c_str());
+    WriteObject(&particleTypes_numpart, (name + "_ParticleTypes_numpart").c_str());
 
 }
 
+Int_t RootFileWriter::WriteObject(TObject* obj, const char* name, Int_t option) {
+    // Write an object to the current directory, and record it in the write manifest
+    auto startTime = std::chrono::steady_clock::now();
+    Int_t nbytes = obj->Write(name, option);
+    std::chrono::duration<double> writeTime = std::chrono::steady_clock::now() - startTime;
+
+    writeManifestEntry entry;
+    entry.name      = (name != NULL) ? G4String(name) : G4String(obj->GetName());
+    entry.className = obj->ClassName();
+    entry.nbytes    = nbytes;
+    entry.writeTime = writeTime.count();
+    writeManifest.push_back(entry);
+
+    return nbytes;
+}
+
+void RootFileWriter::WriteManifest() {
+    // One entry per object written in finalizeRootFile().
+    // For TTrees, nbytes only counts the header and the baskets remaining at the end of the run.
+    char     manifest_name[256];
+    char     manifest_className[64];
+    Int_t    manifest_nbytes;
+    Double_t manifest_writeTime;
+
+    TTree* manifest = new TTree("writeManifest", "Objects written to this file, with size [bytes] and write time [s]");
+    manifest->Branch("name",      manifest_name,       "name/C");
+    manifest->Branch("className", manifest_className,  "className/C");
+    manifest->Branch("nbytes",    &manifest_nbytes,    "nbytes/I");
+    manifest->Branch("writeTime", &manifest_writeTime, "writeTime/D");
+
+    Long64_t totalBytes = 0;
+    G4double totalTime  = 0.0;
+    for (auto& entry : writeManifest) {
+        strncpy(manifest_name,      entry.name.c_str(),      sizeof(manifest_name)-1);
+        manifest_name[sizeof(manifest_name)-1] = '\0';
+        strncpy(manifest_className, entry.className.c_str(), sizeof(manifest_className)-1);
+        manifest_className[sizeof(manifest_className)-1] = '\0';
+        manifest_nbytes    = entry.nbytes;
+        manifest_writeTime = entry.writeTime;
+        manifest->Fill();
+
+        totalBytes += entry.nbytes;
+        totalTime  += entry.writeTime;
+    }
+    manifest->Write(NULL, TObject::kOverwrite);
+    delete manifest;
+
+    G4cout << "Wrote " << writeManifest.size() << " objects, "
+           << totalBytes/1.0e6 << " [MB] in " << totalTime << " [s] to the ROOT file." << G4endl;
+    writeManifest.clear();
+}
+
 void RootFileWriter::FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4String type) {
     if (pt.particleTypes.count(PDG) == 0) {
         pt.particleTypes[PDG] = 0;
@@ -2075,6 +3820,14 @@ void RootFileWriter::FillParticleTypes(particleTypesCounter& pt, G4int PDG, G4St
     pt.numParticles       += 1;
 }
 
+void RootFileWriter::setTreeReservoir(G4int treeReservoir_arg) {
+    if (treeReservoir_arg < 0) {
+        G4cerr << "Error: treeReservoir must be >= 0 (0 => no limit)" << G4endl;
+        exit(1);
+    }
+    this->treeReservoir = treeReservoir_arg;
+}
+
 void RootFileWriter::setEngNbins(G4int edepNbins_in) {
     if (edepNbins_in > 0) {
         this->engNbins = edepNbins_in;
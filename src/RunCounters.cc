@@ -0,0 +1,59 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RunCounters.hh"
+
+#include <utility>
+
+std::map<G4String,RunCounters> RunCounters::registry;
+
+RunCounters* RunCounters::Register(const G4String& name, const std::vector<G4String>& labels) {
+    auto it = registry.find(name);
+    if (it != registry.end()) {
+        if (it->second.labels != labels) {
+            G4cerr << "Error in RunCounters::Register: The counters '" << name
+                   << "' were already registered with different labels" << G4endl;
+            exit(1);
+        }
+        return &(it->second);
+    }
+    // Pointers to the elements of a std::map stay valid when more are added
+    it = registry.insert(std::make_pair(name, RunCounters(name, labels))).first;
+    return &(it->second);
+}
+
+void RunCounters::Reset() {
+    for (auto& v : values) {
+        v = 0.0;
+    }
+}
+
+void RunCounters::SetValues(const std::vector<G4double>& values_in) {
+    if (values_in.size() != values.size()) {
+        G4cerr << "Error when reading checkpoint: Expected " << values.size() << " counters for '"
+               << name << "', got " << values_in.size() << G4endl;
+        exit(1);
+    }
+    values = values_in;
+}
+
+void RunCounters::Print() const {
+    G4cout << name << ":" << G4endl;
+    for (size_t i = 0; i < values.size(); i++) {
+        G4cout << " " << labels[i] << " = " << values[i] << G4endl;
+    }
+}
@@ -0,0 +1,255 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ScatterKernel.hh"
+
+#include "G4SystemOfUnits.hh"
+#include "G4RotationMatrix.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TDirectory.h"
+#include "TVectorD.h"
+#include "TObjString.h"
+
+#include <cmath>
+#include <algorithm>
+
+ScatterKernel::~ScatterKernel() {
+    if (kernelFile != NULL) {
+        CloseForWriting();
+    }
+}
+
+void ScatterKernel::OpenForWriting(G4String fileName_in, G4String material_in, G4double thickness_in,
+                                   G4double energy_in, G4String particle_in) {
+    fileName  = fileName_in;
+    material  = material_in;
+    thickness = thickness_in;
+    energy    = energy_in;
+    particle  = particle_in;
+    numEvents = 0;
+
+    TDirectory* savedDir = gDirectory;
+    kernelFile = new TFile(fileName, "RECREATE");
+    if ( not kernelFile->IsOpen() ) {
+        G4cerr << "Opening kernel file '" << fileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    kernelTree = new TTree("kernel", "Particles leaving the target, per primary");
+    kernelTree->Branch("dx",  &tree_dx);
+    kernelTree->Branch("dy",  &tree_dy);
+    kernelTree->Branch("face",&tree_face);
+    kernelTree->Branch("dz",  &tree_dz);
+    kernelTree->Branch("ux",  &tree_ux);
+    kernelTree->Branch("uy",  &tree_uy);
+    kernelTree->Branch("uz",  &tree_uz);
+    kernelTree->Branch("E",   &tree_E);
+    kernelTree->Branch("PDG", &tree_PDG);
+    savedDir->cd();
+
+    G4cout << "Writing the scattering kernel to '" << fileName << "'" << G4endl;
+}
+
+void ScatterKernel::AddEvent(TrackerHitsCollection* exitHits,
+                             G4double x, G4double xp, G4double y, G4double yp, G4double z0) {
+    // The primary at the target entrance, and the rotation from its frame to the lab frame
+    const G4double zIn = -thickness*mm/2.0;
+    const G4double xIn = x + xp*(zIn - z0);
+    const G4double yIn = y + yp*(zIn - z0);
+    const G4ThreeVector entryPoint(xIn, yIn, zIn);
+    G4RotationMatrix toPrimaryFrame;
+    toPrimaryFrame.rotateUz(G4ThreeVector(xp,yp,1.0).unit());
+    toPrimaryFrame.invert();
+
+    tree_dx.clear(); tree_dy.clear(); tree_face.clear(); tree_dz.clear();
+    tree_ux.clear(); tree_uy.clear(); tree_uz.clear();
+    tree_E.clear();  tree_PDG.clear();
+    if (exitHits != NULL) {
+        for (size_t i = 0; i < exitHits->entries(); i++) {
+            const TrackerHit* hit = (*exitHits)[i];
+            const G4ThreeVector u = toPrimaryFrame * hit->GetMomentum().unit();
+            // The offset along the primary is given by the exit face and dz
+            const G4ThreeVector offset = toPrimaryFrame * (hit->GetPosition() - entryPoint);
+            tree_dx.push_back(offset.x()/mm);
+            tree_dy.push_back(offset.y()/mm);
+            const G4int face = (hit->GetPosition().z() > 0.0) ? 1 : -1;
+            tree_face.push_back(face);
+            tree_dz.push_back((hit->GetPosition().z() - face*thickness*mm/2.0)/mm);
+            tree_ux.push_back(u.x());
+            tree_uy.push_back(u.y());
+            tree_uz.push_back(u.z());
+            tree_E.push_back(hit->GetTrackEnergy()/MeV);
+            tree_PDG.push_back(hit->GetPDG());
+        }
+    }
+    kernelTree->Fill();
+    numEvents++;
+}
+
+void ScatterKernel::CloseForWriting() {
+    TDirectory* savedDir = gDirectory;
+    kernelFile->cd();
+    kernelTree->Write();
+
+    // [thickness [mm], energy [MeV], number of events, format version]
+    TVectorD kernelParameters(4);
+    kernelParameters[0] = thickness;
+    kernelParameters[1] = energy;
+    kernelParameters[2] = double(numEvents);
+    kernelParameters[3] = double(formatVersion);
+    kernelParameters.Write("kernel_parameters");
+    TObjString kernelMaterial(material.c_str());
+    kernelMaterial.Write("kernel_material");
+    TObjString kernelParticle(particle.c_str());
+    kernelParticle.Write("kernel_particle");
+
+    kernelFile->Close();
+    delete kernelFile;
+    kernelFile = NULL;
+    kernelTree = NULL;
+    savedDir->cd();
+
+    G4cout << "Wrote the scattering kernel of " << numEvents << " events to '" << fileName << "'" << G4endl;
+}
+
+void ScatterKernel::Load(G4String fileName_in) {
+    fileName = fileName_in;
+    TFile* inFile = new TFile(fileName, "READ");
+    if ( not inFile->IsOpen() ) {
+        G4cerr << "Opening kernel file '" << fileName << "' failed; quitting." << G4endl;
+        exit(1);
+    }
+    TTree* inTree = (TTree*) inFile->Get("kernel");
+    TVectorD*   kernelParameters = (TVectorD*)   inFile->Get("kernel_parameters");
+    TObjString* kernelMaterial   = (TObjString*) inFile->Get("kernel_material");
+    TObjString* kernelParticle   = (TObjString*) inFile->Get("kernel_particle");
+    if (inTree == NULL or kernelParameters == NULL or kernelMaterial == NULL or kernelParticle == NULL) {
+        G4cerr << "Error: '" << fileName << "' is not a complete kernel file; was it written with --writeKernel?" << G4endl;
+        exit(1);
+    }
+    thickness = (*kernelParameters)[0];
+    energy    = (*kernelParameters)[1];
+    material  = kernelMaterial->GetString().Data();
+    particle  = kernelParticle->GetString().Data();
+
+    if (kernelParameters->GetNrows() < 4 or G4int((*kernelParameters)[3]) != formatVersion) {
+        G4cerr << "Error: The kernel file '" << fileName << "' was made by an older version of MiniScatter;"
+               << " please make it again with --writeKernel" << G4endl;
+        exit(1);
+    }
+    std::vector<Float_t> *dx = NULL, *dy = NULL, *dz = NULL, *ux = NULL, *uy = NULL, *uz = NULL, *E = NULL;
+    std::vector<Int_t>   *face = NULL, *PDG = NULL;
+    inTree->SetBranchAddress("dx",  &dx);
+    inTree->SetBranchAddress("dy",  &dy);
+    inTree->SetBranchAddress("face",&face);
+    inTree->SetBranchAddress("dz",  &dz);
+    inTree->SetBranchAddress("ux",  &ux);
+    inTree->SetBranchAddress("uy",  &uy);
+    inTree->SetBranchAddress("uz",  &uz);
+    inTree->SetBranchAddress("E",   &E);
+    inTree->SetBranchAddress("PDG", &PDG);
+
+    particles.clear();
+    eventStart.clear();
+    numEvents = inTree->GetEntries();
+    for (Long64_t i = 0; i < numEvents; i++) {
+        inTree->GetEntry(i);
+        eventStart.push_back(particles.size());
+        for (size_t j = 0; j < PDG->size(); j++) {
+            particles.push_back({(*dx)[j], (*dy)[j], (*face)[j], (*dz)[j], (*ux)[j], (*uy)[j], (*uz)[j], (*E)[j], (*PDG)[j]});
+        }
+    }
+    eventStart.push_back(particles.size());
+
+    inTree->ResetBranchAddresses();
+    delete dx; delete dy; delete face; delete dz; delete ux; delete uy; delete uz; delete E; delete PDG;
+    inFile->Close();
+    delete inFile;
+
+    if (numEvents == 0) {
+        G4cerr << "Error: The kernel file '" << fileName << "' has no events" << G4endl;
+        exit(1);
+    }
+    G4cout << "Loaded the scattering kernel '" << fileName << "': " << numEvents << " events, "
+           << particles.size() << " particles, for " << particle << " at " << energy << " [MeV]"
+           << " on " << thickness << " [mm] of " << material << G4endl;
+}
+
+void ScatterKernel::CheckCompatible(G4String material_in, G4double thickness_in, G4double angle_in,
+                                    G4double energy_in, G4String particle_in, G4bool flatEnergy) {
+    G4bool ok = true;
+    if (material_in != material) {
+        G4cerr << "Error: The kernel is for the target material '" << material << "', not '" << material_in << "'" << G4endl;
+        ok = false;
+    }
+    if (fabs(thickness_in - thickness) > 1e-9*thickness) {
+        G4cerr << "Error: The kernel is for a target thickness of " << thickness << " [mm], not " << thickness_in << G4endl;
+        ok = false;
+    }
+    if (angle_in != 0.0) {
+        G4cerr << "Error: Kernels can not be used with a rotated target" << G4endl;
+        ok = false;
+    }
+    if (fabs(energy_in - energy) > 1e-9*energy or flatEnergy) {
+        G4cerr << "Error: The kernel is for a beam energy of " << energy << " [MeV], not " << energy_in
+               << (flatEnergy ? " (flat distribution)" : "") << G4endl;
+        ok = false;
+    }
+    if (particle_in != particle) {
+        G4cerr << "Error: The kernel is for the beam particle '" << particle << "', not '" << particle_in << "'" << G4endl;
+        ok = false;
+    }
+    if (not ok) exit(1);
+}
+
+const std::vector<ScatterKernel::sampledParticle>& ScatterKernel::Sample(G4double x, G4double xp,
+                                                                          G4double y, G4double yp, G4double z0) {
+    const G4double zIn = -thickness*mm/2.0;
+    const G4double xIn = x + xp*(zIn - z0);
+    const G4double yIn = y + yp*(zIn - z0);
+    const G4ThreeVector entryPoint(xIn, yIn, zIn);
+    const G4ThreeVector primaryDir = G4ThreeVector(xp,yp,1.0).unit();
+    G4RotationMatrix toLabFrame;
+    toLabFrame.rotateUz(primaryDir);
+
+    // The target and a beam along z are symmetric around the z axis
+    const G4double phi = twopi*G4UniformRand();
+    const G4double cosPhi = cos(phi);
+    const G4double sinPhi = sin(phi);
+
+    const size_t ev = std::min(size_t(G4UniformRand()*numEvents), size_t(numEvents-1));
+    sampled.clear();
+    for (size_t i = eventStart[ev]; i < eventStart[ev+1]; i++) {
+        const kernelParticle& kp = particles[i];
+        sampledParticle sp;
+        sp.PDG = kp.PDG;
+        sp.E   = kp.E*MeV;
+        sp.direction = toLabFrame * G4ThreeVector(kp.ux*cosPhi - kp.uy*sinPhi, kp.ux*sinPhi + kp.uy*cosPhi, kp.uz);
+        // Just inside the face it left through
+        const G4double zInside = kp.face*(thickness*mm/2.0 - 1.0*nm) + kp.dz*mm;
+        // Transverse offset in the frame of the primary, then along the primary to the exit z
+        const G4ThreeVector offset = toLabFrame * G4ThreeVector((kp.dx*cosPhi - kp.dy*sinPhi)*mm,
+                                                                (kp.dx*sinPhi + kp.dy*cosPhi)*mm,
+                                                                0.0);
+        sp.position = entryPoint + offset + primaryDir*((zInside - zIn - offset.z())/primaryDir.z());
+        sampled.push_back(sp);
+    }
+    return sampled;
+}
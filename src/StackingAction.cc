@@ -0,0 +1,174 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "StackingAction.hh"
+#include "SplitString.hh"
+#include "RunCounters.hh"
+
+#include "G4Track.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <string>
+
+StackingAction::StackingAction(G4String stackingString) {
+    definition = stackingString;
+    for (auto ruleString : SplitString(stackingString, ";")) {
+        if (ruleString == "") continue;
+        rules.push_back(ParseRule(ruleString));
+    }
+    if (rules.empty()) {
+        G4cerr << "Error: No rules found in stacking policy '" << stackingString << "'" << G4endl;
+        exit(1);
+    }
+
+    std::vector<G4String> labels;
+    for (auto& rule : rules) {
+        const G4String action = rule.postpone ? "postponed" : "killed";
+        labels.push_back("Tracks " + action + " by '" + rule.definition + "'");
+        labels.push_back("Kinetic energy " + action + " by '" + rule.definition + "' [MeV]");
+    }
+    counters = RunCounters::Register("stacking", labels);
+}
+
+stackingRule StackingAction::ParseRule(G4String ruleString) {
+    stackingRule rule;
+    rule.definition = ruleString;
+
+    for (auto arg : SplitString(ruleString, ":")) {
+        str_size eqPos = arg.index("=",0);
+        if (eqPos == std::string::npos) {
+            G4cerr << "Error when parsing stacking rule key=val pair '" << arg << "', no '=' found!" << G4endl;
+            exit(1);
+        }
+        G4String key = arg(0,eqPos);
+        G4String val = arg(eqPos+1,std::string::npos);
+
+        try {
+            if (key == "action") {
+                if (val == "kill") {
+                    rule.postpone = false;
+                }
+                else if (val == "postpone") {
+                    rule.postpone = true;
+                }
+                else {
+                    G4cerr << "Stacking rule action must be 'kill' or 'postpone', got '" << val << "'" << G4endl;
+                    exit(1);
+                }
+            }
+            else if (key == "PDG") {
+                for (auto p : SplitString(val, ",")) {
+                    rule.PDGs.insert(std::stoi(std::string(p)));
+                }
+            }
+            else if (key == "Emin") {
+                rule.Emin = std::stod(std::string(val));
+            }
+            else if (key == "Emax") {
+                rule.Emax = std::stod(std::string(val));
+            }
+            else if (key == "volume") {
+                for (auto v : SplitString(val, ",")) {
+                    rule.volumes.push_back(v);
+                }
+            }
+            else if (key == "dir") {
+                if (val == "forward") {
+                    rule.direction = +1;
+                }
+                else if (val == "backward") {
+                    rule.direction = -1;
+                }
+                else {
+                    G4cerr << "Stacking rule dir must be 'forward' or 'backward', got '" << val << "'" << G4endl;
+                    exit(1);
+                }
+            }
+            else {
+                G4cerr << "Stacking rule did not understand key '" << key << "'" << G4endl
+                       << "Expected one of 'action', 'PDG', 'Emin', 'Emax', 'volume', 'dir'." << G4endl;
+                exit(1);
+            }
+        }
+        catch (const std::invalid_argument& ia) {
+            G4cerr << "Invalid argument when reading stacking rule key '" << key << "'" << G4endl
+                   << "Got: '" << val << "'" << G4endl
+                   << "Expected a number" << G4endl;
+            exit(1);
+        }
+    }
+
+    if (rule.Emin > rule.Emax) {
+        G4cerr << "Stacking rule '" << ruleString << "' has Emin > Emax, it would never match." << G4endl;
+        exit(1);
+    }
+    return rule;
+}
+
+void StackingAction::ResolveVolumes() {
+    // 'target' is the target, a magnet name matches the magnet and all its daughter volumes
+    // (named '<magnetName>_...'), anything else must be the exact name of a physical volume.
+    G4PhysicalVolumeStore* pvStore = G4PhysicalVolumeStore::GetInstance();
+    for (auto& rule : rules) {
+        for (auto volName : rule.volumes) {
+            const G4String pvName = (volName == "target") ? G4String("TargetPV") : volName;
+            size_t numFound = 0;
+            for (auto pv : *pvStore) {
+                const G4String& name = pv->GetName();
+                if (name == pvName or name.index(pvName + "_") == 0) {
+                    rule.volumePVs.insert(pv);
+                    numFound++;
+                }
+            }
+            if (numFound == 0) {
+                G4cerr << "Error in stacking rule '" << rule.definition << "': "
+                       << "No volume named '" << volName << "'" << G4endl;
+                exit(1);
+            }
+        }
+    }
+    volumesResolved = true;
+}
+
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* track) {
+    if (track->GetParentID() == 0) return fUrgent;
+
+    if (not volumesResolved) ResolveVolumes();
+
+    const G4int    PDG  = track->GetDefinition()->GetPDGEncoding();
+    const G4double Ekin = track->GetKineticEnergy()/MeV;
+    const G4double pz   = track->GetMomentumDirection().z();
+
+    for (size_t i = 0; i < rules.size(); i++) {
+        const stackingRule& rule = rules[i];
+        if (not rule.PDGs.empty() and rule.PDGs.count(PDG) == 0) continue;
+        if (Ekin < rule.Emin or Ekin > rule.Emax) continue;
+        if (rule.direction > 0 and not (pz > 0.0)) continue;
+        if (rule.direction < 0 and not (pz < 0.0)) continue;
+        if (not rule.volumes.empty()) {
+            // Secondaries get the touchable of the step where they were created
+            if (rule.volumePVs.count(track->GetVolume()) == 0) continue;
+        }
+
+        counters->Add(2*i,   1.0);
+        counters->Add(2*i+1, Ekin);
+        return rule.postpone ? fWaiting : fKill;
+    }
+    return fUrgent;
+}
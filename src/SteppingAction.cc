@@ -0,0 +1,158 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SteppingAction.hh"
+#include "DetectorConstruction.hh"
+#include "VirtualTrackerWorldConstruction.hh"
+#include "TrackerSD.hh"
+#include "PlaneScorer.hh"
+#include "RunCounters.hh"
+
+#include "G4Step.hh"
+#include "G4Track.hh"
+#include "G4Navigator.hh"
+#include "G4LogicalVolume.hh"
+#include "G4FieldManager.hh"
+#include "G4TransportationManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <cmath>
+
+SteppingAction::SteppingAction(DetectorConstruction* detCon_in, VirtualTrackerWorldConstruction* trackers_in,
+                               G4bool analyticDrift_in, PlaneScorer* planeScorer_in) :
+    detCon(detCon_in), trackers(trackers_in), analyticDrift(analyticDrift_in), planeScorer(planeScorer_in) {
+    if (analyticDrift) {
+        counters = RunCounters::Register("analyticDrift", {"Tracks drifted to the trackers"});
+    }
+}
+
+SteppingAction::~SteppingAction() {
+    if (navigator != NULL) {
+        delete navigator;
+        navigator = NULL;
+    }
+}
+
+void SteppingAction::UserSteppingAction(const G4Step* step) {
+    if (planeScorer != NULL) {
+        planeScorer->ScoreStep(step);
+    }
+    if (not analyticDrift) return;
+
+    G4Track* track = step->GetTrack();
+    if (track->GetTrackStatus() != fAlive) return;
+
+    if (worldPV == NULL) {
+        worldPV = detCon->getphysiWorld();
+    }
+    const G4StepPoint* postStepPoint = step->GetPostStepPoint();
+    if (postStepPoint->GetPhysicalVolume() != worldPV) return;
+
+    // Unstable particles could decay on the way
+    if (not track->GetDefinition()->GetPDGStable()) return;
+
+    // The fields are set up after the geometry is built, so check on the first use
+    if (not fieldChecked) {
+        G4FieldManager* fieldMgr = worldPV->GetLogicalVolume()->GetFieldManager();
+        if (fieldMgr == NULL) {
+            fieldMgr = G4TransportationManager::GetTransportationManager()->GetFieldManager();
+        }
+        worldHasField = (fieldMgr != NULL and fieldMgr->GetDetectorField() != NULL);
+        fieldChecked = true;
+        if (worldHasField) {
+            G4cout << "SteppingAction: The world has a magnetic field, the analytic drift is disabled." << G4endl;
+        }
+    }
+    if (worldHasField) return;
+
+    if (not IsFreePath(postStepPoint->GetPosition(), postStepPoint->GetMomentumDirection())) return;
+
+    DriftToTrackers(track);
+    track->SetTrackStatus(fStopAndKill);
+    counters->Add(0, 1.0);
+}
+
+G4bool SteppingAction::IsFreePath(const G4ThreeVector& pos, const G4ThreeVector& dir) {
+    if (navigator == NULL) {
+        navigator = new G4Navigator();
+        navigator->SetWorldVolume(const_cast<G4VPhysicalVolume*>(worldPV));
+    }
+
+    // On a boundary, the direction decides which volume we are in
+    if (navigator->LocateGlobalPointAndSetup(pos, &dir, false, false) != worldPV) return false;
+
+    G4double safety = 0.0;
+    const G4double nextBoundary = navigator->ComputeStep(pos, dir, kInfinity, safety);
+    return nextBoundary >= DistanceToWorldEdge(pos, dir) - 1.0*nm;
+}
+
+G4double SteppingAction::DistanceToWorldEdge(const G4ThreeVector& pos, const G4ThreeVector& dir) const {
+    const G4double halfSize[3] = { detCon->getWorldSizeX()/2.0,
+                                   detCon->getWorldSizeY()/2.0,
+                                   detCon->getWorldSizeZ()/2.0 };
+    G4double dist = kInfinity;
+    for (int i = 0; i < 3; i++) {
+        if (dir[i] == 0.0) continue;
+        const G4double edge = (dir[i] > 0.0) ? halfSize[i] : -halfSize[i];
+        dist = std::min(dist, (edge - pos[i]) / dir[i]);
+    }
+    return dist;
+}
+
+void SteppingAction::DriftToTrackers(const G4Track* track) {
+    const G4ThreeVector& pos      = track->GetPosition();
+    const G4ThreeVector& dir      = track->GetMomentumDirection();
+    const G4ThreeVector  momentum = track->GetMomentum();
+    const G4double       energy   = track->GetKineticEnergy();
+
+    const G4double angle     = trackers->getTrackerAngle();
+    const G4double thickness = trackers->getTrackerThickness();
+    const G4ThreeVector normal(sin(angle), 0.0, cos(angle));
+    const G4double dirNormal = normal.dot(dir);
+    if (dirNormal == 0.0) return; // Parallel to the planes
+
+    // A track on the entrance face has not been recorded yet, while one that
+    // has passed it has; the tolerance is far below the plane thickness.
+    const G4double tolerance = 1.0e-3 * thickness;
+
+    const std::vector<G4double>& distances = trackers->getTrackerDistances();
+    for (size_t idx = 0; idx < distances.size(); idx++) {
+        // The face the track enters through; the downstream face passes through (0,0,distance)
+        const G4double facePos = distances[idx]*cos(angle) - ( (dirNormal > 0.0) ? thickness : 0.0 );
+        const G4double pathLength = (facePos - normal.dot(pos)) / dirNormal;
+        if (pathLength * fabs(dirNormal) < -tolerance) continue; // Behind the track
+
+        const G4ThreeVector hitPos = pos + pathLength*dir;
+
+        // Inside the plane...
+        const G4ThreeVector center(-sin(angle)*thickness/2.0, 0.0, distances[idx] - cos(angle)*thickness/2.0);
+        const G4ThreeVector delta = hitPos - center;
+        if (fabs(cos(angle)*delta.x() - sin(angle)*delta.z()) > trackers->getTrackerSizeX()/2.0) continue;
+        if (fabs(delta.y()) > trackers->getTrackerSizeY()/2.0) continue;
+        // ... and inside the world
+        if (fabs(hitPos.x()) > detCon->getWorldSizeX()/2.0 or
+            fabs(hitPos.y()) > detCon->getWorldSizeY()/2.0 or
+            fabs(hitPos.z()) > detCon->getWorldSizeZ()/2.0) continue;
+
+        trackers->getTrackerSD(idx)->AddHit(hitPos, momentum, energy, track->GetDefinition());
+    }
+
+    if (planeScorer != NULL) {
+        const G4ThreeVector endPos = pos + DistanceToWorldEdge(pos, dir)*dir;
+        planeScorer->ScoreSegment(pos, endPos, momentum, momentum, energy, energy, track->GetDefinition());
+    }
+}
@@ -0,0 +1,239 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "TargetFastSimModel.hh"
+#include "RunCounters.hh"
+
+#include "G4FastTrack.hh"
+#include "G4FastStep.hh"
+#include "G4Track.hh"
+#include "G4Material.hh"
+#include "G4Box.hh"
+#include "G4Gamma.hh"
+#include "G4DynamicParticle.hh"
+#include "G4Poisson.hh"
+#include "G4PhysicalConstants.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/RandLandau.h"
+#include "CLHEP/Random/RandGamma.h"
+
+#include <cmath>
+#include <cstdlib>
+
+TargetFastSimModel::TargetFastSimModel(G4String modelName, G4Region* envelope, G4double targetThickness_arg) :
+    G4VFastSimulationModel(modelName, envelope), targetThickness(targetThickness_arg) {
+    counters = RunCounters::Register("targetFastSim", {"Tracks moved through the target"});
+}
+
+G4bool TargetFastSimModel::IsApplicable(const G4ParticleDefinition& particle) {
+    return particle.GetPDGCharge() != 0.0 and particle.GetPDGMass() > 0.0;
+}
+
+void TargetFastSimModel::SetupMaterial(const G4Material* material) {
+    currentMaterial = material;
+    radLength       = material->GetRadlen();
+    meanExcitation  = material->GetIonisation()->GetMeanExcitationEnergy();
+
+    // chi_c^2 = 4 pi r_e^2 (m_e c^2)^2 z^2 sum_i(n_i Z_i (Z_i+1)) x / (p beta)^2,
+    // i.e. 0.157 Z(Z+1)/A z^2 x[g/cm^2] / (p beta [MeV])^2 for one element
+    const G4ElementVector* elements = material->GetElementVector();
+    const G4double* atomsPerVolume  = material->GetVecNbOfAtomsPerVolume();
+    G4double sumZZ = 0.0;
+    for (size_t i = 0; i < material->GetNumberOfElements(); i++) {
+        const G4double Z = (*elements)[i]->GetZ();
+        sumZZ += atomsPerVolume[i] * Z*(Z+1);
+    }
+    chic2Factor = 4*pi * pow(classic_electr_radius*electron_mass_c2, 2) * sumZZ;
+
+    // For compounds, log(chi_a) is averaged with the weights n_i Z_i (Z_i+1)
+    screeningElements.clear();
+    for (size_t i = 0; i < material->GetNumberOfElements(); i++) {
+        const G4double Z = (*elements)[i]->GetZ();
+        screeningElements.push_back(std::make_pair(atomsPerVolume[i] * Z*(Z+1) / sumZZ, Z));
+    }
+
+    // xi = K/2 <Z/A> rho z^2 x / beta^2 = 2 pi r_e^2 m_e c^2 n_e z^2 x / beta^2
+    xiFactor = twopi * pow(classic_electr_radius, 2) * electron_mass_c2 * material->GetElectronDensity();
+}
+
+G4double TargetFastSimModel::ScreeningAngle2(G4double p, G4double beta, G4double charge) {
+    // chi_a^2 = chi_0^2 (1.13 + 3.76 (alpha Z z/beta)^2), with chi_0 = hbar/(p a) and
+    // the Thomas-Fermi radius a = 0.885 a_0 Z^(-1/3)
+    G4double logChia2 = 0.0;
+    for (auto& element : screeningElements) {
+        const G4double Z      = element.second;
+        const G4double chi0   = hbarc / (p * 0.885*Bohr_radius*pow(Z, -1.0/3.0));
+        const G4double alphaZ = fine_structure_const*Z*charge/beta;
+        logChia2 += element.first * log(chi0*chi0 * (1.13 + 3.76*alphaZ*alphaZ));
+    }
+    return exp(logChia2);
+}
+
+void TargetFastSimModel::LandauParameters(const G4Track* track, G4double x, G4double& mpLoss, G4double& xi) {
+    const G4double mass   = track->GetDefinition()->GetPDGMass();
+    const G4double charge = track->GetDynamicParticle()->GetCharge()/eplus;
+    const G4double gamma  = 1.0 + track->GetKineticEnergy()/mass;
+    const G4double bg2    = gamma*gamma - 1.0;
+    const G4double beta2  = bg2/(gamma*gamma);
+
+    xi = xiFactor * charge*charge * x / beta2;
+    // PDG most probable energy loss, with the density effect correction as a function of log10(beta*gamma)
+    const G4double delta = currentMaterial->GetIonisation()->DensityCorrection(0.5*log10(bg2));
+    mpLoss = xi * (log(2*electron_mass_c2*bg2/meanExcitation) + log(xi/meanExcitation) + 0.2 - beta2 - delta);
+    if (mpLoss < 0.0) mpLoss = 0.0;
+}
+
+G4bool TargetFastSimModel::ModelTrigger(const G4FastTrack& fastTrack) {
+    // Only when entering through the upstream face, going downstream
+    const G4ThreeVector& pos = fastTrack.GetPrimaryTrackLocalPosition();
+    const G4ThreeVector& dir = fastTrack.GetPrimaryTrackLocalDirection();
+    if (dir.z() <= 0.0) return false;
+    if (pos.z() > -targetThickness/2.0 + faceTolerance) return false;
+
+    const G4double x = targetThickness/dir.z(); // Path length
+
+    // The lateral displacement must not take the track out through the sides
+    const G4Box* box = dynamic_cast<const G4Box*>(fastTrack.GetEnvelopeSolid());
+    if (box != NULL) {
+        const G4ThreeVector exitPos = pos + dir*x;
+        if (fabs(exitPos.x()) > box->GetXHalfLength() - x || fabs(exitPos.y()) > box->GetYHalfLength() - x ||
+            fabs(pos.x())     > box->GetXHalfLength() - x || fabs(pos.y())     > box->GetYHalfLength() - x) {
+            return false;
+        }
+    }
+
+    if (fastTrack.GetEnvelopeMaterial() != currentMaterial) {
+        SetupMaterial(fastTrack.GetEnvelopeMaterial());
+    }
+
+    // The target must be thin for this track
+    const G4Track* track = fastTrack.GetPrimaryTrack();
+    G4double mpLoss, xi;
+    LandauParameters(track, x, mpLoss, xi);
+    if (mpLoss > maxLossFraction*track->GetKineticEnergy()) return false;
+    if (abs(track->GetDefinition()->GetPDGEncoding()) == 11 and BremsLossFraction(x) > maxLossFraction) return false;
+
+    return true;
+}
+
+void TargetFastSimModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep) {
+    const G4Track* track   = fastTrack.GetPrimaryTrack();
+    const G4ThreeVector pos = fastTrack.GetPrimaryTrackLocalPosition();
+    const G4ThreeVector dir = fastTrack.GetPrimaryTrackLocalDirection();
+
+    const G4double x      = targetThickness/dir.z(); // Path length
+    const G4double Ekin   = track->GetKineticEnergy();
+    const G4double charge = track->GetDynamicParticle()->GetCharge()/eplus;
+    const G4double p      = track->GetMomentum().mag();
+    const G4double beta   = p/track->GetTotalEnergy();
+
+    // Highland (PDG) width of the projected angle, only used to split the core from the tail
+    const G4double t = x/radLength;
+    G4double theta0 = 13.6*MeV/(beta*p) * fabs(charge) * sqrt(t) * (1 + 0.038*log(t*charge*charge/(beta*beta)));
+    if (theta0 < 0.0) theta0 = 0.0;
+    const G4double thetaCut = tailCut*theta0;
+
+    // Screened Rutherford scattering: The number of scatterings above an angle theta
+    // is chi_c^2/(theta^2 + chi_a^2). The Gaussian core has the projected variance of
+    // the scatterings below thetaCut, (chi_c^2/2) (ln(1 + thetaCut^2/chi_a^2) - thetaCut^2/(thetaCut^2 + chi_a^2)).
+    const G4double chic2 = chic2Factor * charge*charge * x / pow(p*beta, 2);
+    const G4double chia2 = ScreeningAngle2(p, beta, charge);
+    const G4double cut2  = thetaCut*thetaCut;
+    G4double thetaCore = 0.0;
+    if (thetaCut > 0.0) {
+        const G4double coreVariance = 0.5*chic2*(log(1.0 + cut2/chia2) - cut2/(cut2 + chia2));
+        if (coreVariance > 0.0) thetaCore = sqrt(coreVariance);
+    }
+
+    // Projected angles and the correlated displacements in the two planes (PDG eq. for y_plane),
+    // in a frame (u,v) perpendicular to the incoming direction
+    G4double thetaU = 0.0, thetaV = 0.0, dispU = 0.0, dispV = 0.0;
+    G4double z1 = G4RandGauss::shoot();
+    G4double z2 = G4RandGauss::shoot();
+    thetaU = z2*thetaCore;
+    dispU  = x*thetaCore*(z1/sqrt(12.0) + z2/2.0);
+    z1 = G4RandGauss::shoot();
+    z2 = G4RandGauss::shoot();
+    thetaV = z2*thetaCore;
+    dispV  = x*thetaCore*(z1/sqrt(12.0) + z2/2.0);
+
+    // Single scattering tail above thetaCut, each scattering at a uniformly distributed depth
+    if (thetaCut > 0.0) {
+        const G4long numTail = G4Poisson(chic2/(cut2 + chia2));
+        for (G4long i = 0; i < numTail; i++) {
+            const G4double thetaTail = sqrt((cut2 + chia2)/(1.0 - G4UniformRand()) - chia2);
+            if (thetaTail > 1.0) continue; // Outside of the small angle approximation
+            const G4double phi       = twopi*G4UniformRand();
+            const G4double remaining = x*G4UniformRand(); // Path length after the scattering
+            thetaU += thetaTail*cos(phi);
+            thetaV += thetaTail*sin(phi);
+            dispU  += thetaTail*cos(phi)*remaining;
+            dispV  += thetaTail*sin(phi)*remaining;
+        }
+    }
+
+    const G4ThreeVector u = dir.orthogonal().unit();
+    const G4ThreeVector v = dir.cross(u);
+    const G4double thetaSpace = sqrt(thetaU*thetaU + thetaV*thetaV);
+    G4ThreeVector newDir = dir;
+    if (thetaSpace > 0.0) {
+        newDir = dir*cos(thetaSpace) + (u*thetaU + v*thetaV)*(sin(thetaSpace)/thetaSpace);
+    }
+    if (newDir.z() <= 0.0) newDir = dir; // Can not happen within the small angle cut
+
+    G4ThreeVector newPos = pos + dir*x + u*dispU + v*dispV;
+    newPos.setZ(targetThickness/2.0 - faceTolerance);
+
+    // Collision energy loss, Landau distributed around the most probable loss
+    // (the maximum of the standard Landau density is at lambda = -0.22278)
+    G4double mpLoss, xi;
+    LandauParameters(track, x, mpLoss, xi);
+    G4double eLoss = mpLoss + xi*(CLHEP::RandLandau::shoot(G4Random::getTheEngine()) + 0.22278);
+    if (eLoss < 0.0) eLoss = 0.0;
+
+    counters->Add(0, 1.0);
+
+    fastStep.ProposePrimaryTrackPathLength(x);
+    fastStep.ProposePrimaryTrackFinalTime(track->GetGlobalTime() + x/(beta*c_light));
+    fastStep.ForceSteppingHitInvocation(); // So that the energy deposit is scored by TargetSD
+
+    if (eLoss >= Ekin) {
+        fastStep.KillPrimaryTrack();
+        fastStep.ProposeTotalEnergyDeposited(Ekin);
+        return;
+    }
+    G4double Eout = Ekin - eLoss;
+
+    // Bremsstrahlung for e+/e-, E_out/E_in = exp(-G) where G is Gamma distributed with shape 4/3*t
+    G4double Erad = 0.0;
+    if (abs(track->GetDefinition()->GetPDGEncoding()) == 11) {
+        const G4double G = CLHEP::RandGamma::shoot(G4Random::getTheEngine(), t*4.0/3.0, 1.0);
+        Erad = Eout*(1.0 - exp(-G));
+        Eout -= Erad;
+    }
+
+    fastStep.ProposePrimaryTrackFinalPosition(newPos);
+    fastStep.ProposePrimaryTrackFinalMomentumDirection(newDir);
+    fastStep.ProposePrimaryTrackFinalKineticEnergy(Eout);
+    fastStep.ProposeTotalEnergyDeposited(eLoss);
+
+    if (Erad > 0.0) {
+        fastStep.SetNumberOfSecondaryTracks(1);
+        G4DynamicParticle photon(G4Gamma::Definition(), newDir, Erad);
+        fastStep.CreateSecondaryTrack(photon, newPos, track->GetGlobalTime() + x/(beta*c_light));
+    }
+}
@@ -67,13 +67,17 @@ G4bool TrackerSD::ProcessHits(G4Step* aStep, G4TouchableHistory*) {
   const G4ThreeVector& hitPos = aStep->GetPreStepPoint()->GetPosition();
 
   G4Track* theTrack = aStep->GetTrack();
-  G4ParticleDefinition* particleType = theTrack->GetDefinition();
+  AddHit(hitPos, momentum, energy, theTrack->GetDefinition());
+
+  return true;
+}
+
+void TrackerSD::AddHit(const G4ThreeVector& hitPos, const G4ThreeVector& momentum, G4double energy,
+                       const G4ParticleDefinition* particleType) {
   G4int particleID = particleType->GetPDGEncoding();
   G4int particleCharge = particleType->GetPDGCharge();
 
   TrackerHit* aHit = new TrackerHit(hitPos, momentum, energy, particleID, particleCharge);
   aHit->SetType(particleType->GetParticleSubType());
   fHitsCollection->insert(aHit);
-
-  return true;
 }
@@ -0,0 +1,105 @@
+/*
+ * This file is part of MiniScatter.
+ *
+ *  MiniScatter is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  MiniScatter is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with MiniScatter.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "TreeHitFilter.hh"
+#include "SplitString.hh"
+
+#include <string>
+
+void TreeHitFilter::Parse(G4String filterString) {
+    definition = filterString;
+    active     = true;
+
+    for (auto arg : SplitString(filterString, ":")) {
+        str_size eqPos = arg.index("=",0);
+        if (eqPos == std::string::npos) {
+            G4cerr << "Error when parsing tree filter key=val pair '" << arg << "', no '=' found!" << G4endl;
+            exit(1);
+        }
+        G4String key = arg(0,eqPos);
+        G4String val = arg(eqPos+1,std::string::npos);
+
+        try {
+            if (key == "planes") {
+                for (auto p : SplitString(val, ",")) {
+                    if (p == "target") {
+                        planes.insert(0);
+                    }
+                    else {
+                        planes.insert(std::stoi(std::string(p)));
+                    }
+                }
+            }
+            else if (key == "PDG") {
+                for (auto p : SplitString(val, ",")) {
+                    PDGs.insert(std::stoi(std::string(p)));
+                }
+            }
+            else if (key == "Emin") {
+                Emin = std::stod(std::string(val));
+            }
+            else if (key == "Emax") {
+                Emax = std::stod(std::string(val));
+            }
+            else if (key == "Rmin") {
+                Rmin = std::stod(std::string(val));
+            }
+            else if (key == "Rmax") {
+                Rmax = std::stod(std::string(val));
+            }
+            else {
+                G4cerr << "Tree filter did not understand key '" << key << "'" << G4endl
+                       << "Expected one of 'planes', 'PDG', 'Emin', 'Emax', 'Rmin', 'Rmax'." << G4endl;
+                exit(1);
+            }
+        }
+        catch (const std::invalid_argument& ia) {
+            G4cerr << "Invalid argument when reading tree filter key '" << key << "'" << G4endl
+                   << "Got: '" << val << "'" << G4endl
+                   << "Expected a number, or for 'planes' a tracker number or 'target'" << G4endl;
+            exit(1);
+        }
+    }
+
+    if (Emin > Emax or Rmin > Rmax) {
+        G4cerr << "Tree filter '" << definition << "' has min > max, nothing would be stored." << G4endl;
+        exit(1);
+    }
+}
+
+void TreeHitFilter::Print() const {
+    if (not active) {
+        G4cout << "Tree filter: not active" << G4endl;
+        return;
+    }
+    G4cout << "Tree filter '" << definition << "':" << G4endl;
+    G4cout << " planes = ";
+    if (planes.empty()) G4cout << "all";
+    for (auto p : planes) {
+        if (p == 0) G4cout << "target ";
+        else        G4cout << p << " ";
+    }
+    G4cout << G4endl;
+    G4cout << " PDG    = ";
+    if (PDGs.empty()) G4cout << "all";
+    for (auto p : PDGs) {
+        G4cout << p << " ";
+    }
+    G4cout << G4endl;
+    G4cout << " E      = [" << Emin << ", " << Emax << "] [MeV]" << G4endl
+           << " R      = [" << Rmin << ", " << Rmax << "] [mm]"  << G4endl;
+}
@@ -94,9 +94,10 @@ void VirtualTrackerWorldConstruction::ConstructSD() {
     int idx = 0;
     for (auto tLV : virtualTrackerLVs) {
         idx++;
-        G4VSensitiveDetector* trackerSD = new TrackerSD(G4String("tracker_")+std::to_string(idx));
+        TrackerSD* trackerSD = new TrackerSD(G4String("tracker_")+std::to_string(idx));
         SDman->AddNewDetector(trackerSD);
         tLV->SetSensitiveDetector(trackerSD);
+        trackerSDs.push_back(trackerSD);
     }
 
 }